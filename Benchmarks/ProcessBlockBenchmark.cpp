@@ -0,0 +1,630 @@
+/*
+  ==============================================================================
+
+    ProcessBlockBenchmark.cpp
+    Headless timing of Atmos3DDelayAudioProcessor::processBlock.
+
+    Runs every combination of bus layout, sample rate, block size and delay
+    option on synthetic noise and prints one JSON report, e.g.
+
+        Atmos3DDelayBenchmark --layouts=7.1.2,9.1.6 --sample-rates=48000,96000 --block-sizes=64,512 --output=bench.json
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "RealtimeSafety.h"
+
+#include <iostream>
+
+using namespace juce;
+using namespace std;
+
+namespace
+{
+    struct BenchmarkCase
+    {
+        AudioChannelSet layout;
+        double  sampleRate;
+        int     blockSize;
+        int     delayOption;
+        int     interpolation;
+        bool    compactHistory;
+        bool    parallel;
+        int     tileSize;
+        bool    doublePrecision;
+        int     automation;
+        bool    sampleAccurate;
+    };
+
+    enum Automation { staticParameters, lfoSweep, stepChanges, randomJumps };
+    const StringArray automationNames { "static", "lfo", "steps", "random" };
+
+    // The controls mixes automate most, and the ones whose changes cost the most to follow
+    const char* const automatedParameters[] = { "delayTime", "lowpass", "highpass", "inGain", "outGain" };
+
+    /** Normalised value of an automated parameter, seconds into a case. Each parameter has its own phase. */
+    float getAutomationValue(int automation, int parameterIndex, double seconds, Random& random)
+    {
+        const double phase = (double)parameterIndex / (double)numElementsInArray(automatedParameters);
+
+        switch (automation)
+        {
+            case lfoSweep:      return (float)(0.5 + 0.45 * std::sin(MathConstants<double>::twoPi * (0.5 * seconds + phase)));
+            case stepChanges:   return std::fmod(2.0 * seconds + phase, 1.0) < 0.5 ? 0.2f : 0.8f;
+            case randomJumps:   return random.nextFloat();
+            default:            jassertfalse; return 0.5f;
+        }
+    }
+
+    Array<int> parseList(const String& text, const Array<int>& defaults, int minimum = 1)
+    {
+        if (text.isEmpty())
+            return defaults;
+
+        Array<int> values;
+
+        for (auto& token : StringArray::fromTokens(text, ",", ""))
+            if (token.trim().getIntValue() >= minimum)
+                values.add(token.trim().getIntValue());
+
+        return values;
+    }
+
+    void setParameter(Atmos3DDelayAudioProcessor& processor, const String& parameterID, float value)
+    {
+        auto* parameter = processor.parameters.getParameter(parameterID);
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+    }
+
+    /** Delay modes run through Delay Options then Delay Network, as ParameterSnapshot::getDelayMode() counts them. */
+    void setDelayMode(Atmos3DDelayAudioProcessor& processor, int mode)
+    {
+        ParameterSnapshot values;
+        values.setDelayMode(mode);
+        setParameter(processor, "delay_option", (float)values.delayOption);
+        setParameter(processor, "delay_network", (float)values.delayNetwork);
+    }
+
+    StringArray getDelayModeNames(Atmos3DDelayAudioProcessor& processor)
+    {
+        StringArray names;
+
+        if (auto* choices = dynamic_cast<AudioParameterChoice*>(processor.parameters.getParameter("delay_option")))
+            names.addArray(choices->choices);
+
+        if (auto* choices = dynamic_cast<AudioParameterChoice*>(processor.parameters.getParameter("delay_network")))
+            names.addArray(choices->choices, 1);
+
+        return names;
+    }
+
+    /**
+        Renders one block with an Output Gain change queued at offset, and the same block as two host calls split at
+        offset with the change set between them. A sample-accurate change gives exactly the split render, and
+        matches a render without the change up to offset; that render tiles the block differently, so only to
+        within rounding.
+    */
+    bool checkSampleAccurateChange(int blockSize, int offset)
+    {
+        const double sampleRate = 48000.0;
+        Atmos3DDelayAudioProcessor queued, split, unchanged;
+
+        for (auto* processor : { &queued, &split, &unchanged })
+        {
+            processor->setRateAndBufferSizeDetails(sampleRate, blockSize);
+            processor->prepareToPlay(sampleRate, blockSize);
+        }
+
+        const int numChannels = jmax(queued.getTotalNumInputChannels(), queued.getTotalNumOutputChannels());
+        auto* outGain = queued.parameters.getParameter("outGain");
+        const float newValue = outGain->getValue() * 0.5f;
+
+        AudioBuffer<float> buffers[3];
+        MidiBuffer midi;
+        Random random(0x5a);
+
+        // A few identical blocks first, so there is delayed signal in the output too
+        for (int block = 0; block < 5; ++block)
+        {
+            for (auto& buffer : buffers)
+                buffer.setSize(numChannels, blockSize);
+
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                for (int sample = 0; sample < blockSize; ++sample)
+                {
+                    const float value = 0.25f * (2.0f * random.nextFloat() - 1.0f);
+
+                    for (auto& buffer : buffers)
+                        buffer.setSample(channel, sample, value);
+                }
+            }
+
+            if (block < 4)
+            {
+                queued.processBlock(buffers[0], midi);
+                split.processBlock(buffers[1], midi);
+                unchanged.processBlock(buffers[2], midi);
+            }
+        }
+
+        queued.queueParameterChange(outGain->getParameterIndex(), newValue, offset);
+        queued.processBlock(buffers[0], midi);
+
+        AudioBuffer<float> before(buffers[1].getArrayOfWritePointers(), numChannels, 0, offset);
+        AudioBuffer<float> after(buffers[1].getArrayOfWritePointers(), numChannels, offset, blockSize - offset);
+        split.processBlock(before, midi);
+        split.parameters.getParameter("outGain")->setValueNotifyingHost(newValue);
+        split.processBlock(after, midi);
+
+        unchanged.processBlock(buffers[2], midi);
+
+        bool matchesSplit = true, matchesUnchangedBefore = true, changesAfter = false;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            for (int sample = 0; sample < blockSize; ++sample)
+            {
+                const float value = buffers[0].getSample(channel, sample);
+
+                matchesSplit &= value == buffers[1].getSample(channel, sample);
+
+                const bool differs = std::abs(value - buffers[2].getSample(channel, sample)) > 1.0e-6f;
+
+                if (sample < offset)
+                    matchesUnchangedBefore &= ! differs;
+                else
+                    changesAfter |= differs;
+            }
+        }
+
+        if (! (matchesSplit && matchesUnchangedBefore && changesAfter))
+            cerr << "Change queued at " << offset << " of " << blockSize << ":"
+                 << (matchesSplit ? "" : " differs from the split render")
+                 << (matchesUnchangedBefore ? "" : " changes the output before its offset")
+                 << (changesAfter ? "" : " never changes the output") << endl;
+
+        return matchesSplit && matchesUnchangedBefore && changesAfter;
+    }
+
+    /** Nearest-rank percentile of an already sorted list. */
+    double percentile(const vector<double>& sorted, double fraction)
+    {
+        const auto rank = (size_t)jlimit(0.0, (double)(sorted.size() - 1), ceil(fraction * (double)sorted.size()) - 1.0);
+        return sorted[rank];
+    }
+
+    template <typename FloatType>
+    var runCase(const BenchmarkCase& benchmarkCase, double secondsOfAudio, int warmupBlocks)
+    {
+        Atmos3DDelayAudioProcessor processor;
+
+        AudioProcessor::BusesLayout layout;
+        layout.inputBuses.add(benchmarkCase.layout);
+        layout.outputBuses.add(benchmarkCase.layout);
+
+        if (! processor.setBusesLayout(layout))
+            return {};
+
+        const auto sampleRate = benchmarkCase.sampleRate;
+        const auto blockSize = benchmarkCase.blockSize;
+
+        processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+        setDelayMode(processor, benchmarkCase.delayOption);
+        setParameter(processor, "interpolation", (float)benchmarkCase.interpolation);
+        processor.setCompactHistory(benchmarkCase.compactHistory);
+        processor.setParallelProcessing(benchmarkCase.parallel);
+        processor.setTileSize(benchmarkCase.tileSize);
+        processor.setProcessingPrecision(benchmarkCase.doublePrecision ? AudioProcessor::doublePrecision : AudioProcessor::singlePrecision);
+        processor.prepareToPlay(sampleRate, blockSize);
+
+        const int numChannels = jmax(processor.getTotalNumInputChannels(), processor.getTotalNumOutputChannels());
+
+        // Automated controls move before every block, the way a host applies automation between calls, or with
+        // --sample-accurate are queued every automationInterval samples inside it, splitting the block there
+        Array<AudioProcessorParameter*> automated;
+        Array<std::atomic<float>*> automatedValues;
+        Random automationRandom(0xa7);
+        int64 blocksProcessed = 0;
+
+        if (benchmarkCase.automation != staticParameters)
+        {
+            for (auto* parameterID : automatedParameters)
+            {
+                automated.add(processor.parameters.getParameter(parameterID));
+                automatedValues.add(processor.parameters.getRawParameterValue(parameterID));
+            }
+        }
+
+        const int automationInterval = benchmarkCase.sampleAccurate ? jmax(32, blockSize / 32) : blockSize;
+
+        auto automateBlock = [&]
+        {
+            const int64 blockStart = blocksProcessed++ * blockSize;
+
+            for (int offset = 0; offset < blockSize; offset += automationInterval)
+            {
+                const double seconds = (double)(blockStart + offset) / sampleRate;
+
+                for (int i = 0; i < automated.size(); ++i)
+                {
+                    const float value = getAutomationValue(benchmarkCase.automation, i, seconds, automationRandom);
+
+                    if (benchmarkCase.sampleAccurate)
+                        processor.queueParameterChange(automated[i]->getParameterIndex(), value, offset);
+                    else
+                        automated[i]->setValueNotifyingHost(value);
+                }
+            }
+        };
+
+        // What processBlock reads the parameters from, checked after each timed block, so a run whose automation
+        // never reaches the processor shows up instead of passing for a static one
+        vector<float> lastValues;
+        int64 parameterChanges = 0;
+
+        for (auto* value : automatedValues)
+            lastValues.push_back(value->load());
+
+        auto countParameterChanges = [&]
+        {
+            for (int i = 0; i < automatedValues.size(); ++i)
+            {
+                const float value = automatedValues[i]->load();
+
+                if (value != lastValues[(size_t)i])
+                {
+                    lastValues[(size_t)i] = value;
+                    ++parameterChanges;
+                }
+            }
+        };
+
+        // One second of noise, copied into the block before each call so generating it is not timed
+        AudioBuffer<FloatType> source(numChannels, (int)sampleRate);
+        Random random(0x3d);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            for (int sample = 0; sample < source.getNumSamples(); ++sample)
+                source.setSample(channel, sample, (FloatType)(0.25f * (2.0f * random.nextFloat() - 1.0f)));
+
+        AudioBuffer<FloatType> buffer(numChannels, blockSize);
+        MidiBuffer midi;
+        int sourcePosition = 0;
+
+        auto fillBlock = [&]
+        {
+            for (int done = 0; done < blockSize;)
+            {
+                const int count = jmin(blockSize - done, source.getNumSamples() - sourcePosition);
+
+                for (int channel = 0; channel < numChannels; ++channel)
+                    buffer.copyFrom(channel, done, source, channel, sourcePosition, count);
+
+                done += count;
+                sourcePosition = (sourcePosition + count) % source.getNumSamples();
+            }
+        };
+
+        // Warm-up blocks count too: lazy set-up on the first block is still a real-time violation
+        RealtimeSafety::resetReport();
+
+        for (int block = 0; block < warmupBlocks; ++block)
+        {
+            fillBlock();
+            automateBlock();
+            processor.processBlock(buffer, midi);
+            processor.notifyQueuedParameterChanges();
+        }
+
+        const int numBlocks = jmax(1, (int)(secondsOfAudio * sampleRate / blockSize));
+        const double nanosecondsPerTick = 1.0e9 / (double)Time::getHighResolutionTicksPerSecond();
+
+        vector<double> blockTimes;
+        blockTimes.reserve((size_t)numBlocks);
+
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            fillBlock();
+            automateBlock();
+
+            const auto start = Time::getHighResolutionTicks();
+            processor.processBlock(buffer, midi);
+            const auto end = Time::getHighResolutionTicks();
+
+            blockTimes.push_back((double)(end - start) * nanosecondsPerTick);
+
+            // What the processor's timer would do between blocks; there is no message loop here
+            processor.notifyQueuedParameterChanges();
+            countParameterChanges();
+        }
+
+        const auto realtimeReport = RealtimeSafety::getReport();
+        const int workerThreads = processor.getNumWorkerThreads();
+        processor.releaseResources();
+
+        double totalNanoseconds = 0.0;
+
+        for (auto time : blockTimes)
+            totalNanoseconds += time;
+
+        vector<double> sorted(blockTimes);
+        std::sort(sorted.begin(), sorted.end());
+
+        const double samplesProcessed = (double)numBlocks * blockSize;
+        const auto modeNames = getDelayModeNames(processor);
+        auto* interpolations = dynamic_cast<AudioParameterChoice*>(processor.parameters.getParameter("interpolation"));
+
+        DynamicObject::Ptr blockMicroseconds = new DynamicObject();
+        blockMicroseconds->setProperty("mean",  totalNanoseconds / numBlocks * 1.0e-3);
+        blockMicroseconds->setProperty("p50",   percentile(sorted, 0.50) * 1.0e-3);
+        blockMicroseconds->setProperty("p90",   percentile(sorted, 0.90) * 1.0e-3);
+        blockMicroseconds->setProperty("p99",   percentile(sorted, 0.99) * 1.0e-3);
+        blockMicroseconds->setProperty("p999",  percentile(sorted, 0.999) * 1.0e-3);
+        blockMicroseconds->setProperty("max",   sorted.back() * 1.0e-3);
+
+        DynamicObject::Ptr result = new DynamicObject();
+        result->setProperty("layout",           benchmarkCase.layout.getDescription());
+        result->setProperty("sample_rate",      sampleRate);
+        result->setProperty("block_size",       blockSize);
+        result->setProperty("delay_option",     isPositiveAndBelow(benchmarkCase.delayOption, modeNames.size()) ? modeNames[benchmarkCase.delayOption] : String(benchmarkCase.delayOption));
+        result->setProperty("interpolation",    interpolations != nullptr ? interpolations->choices[benchmarkCase.interpolation] : String(benchmarkCase.interpolation));
+        result->setProperty("channels",         numChannels);
+        result->setProperty("precision",        benchmarkCase.doublePrecision ? "double" : "float");
+        result->setProperty("automation",       automationNames[benchmarkCase.automation]);
+        result->setProperty("sample_accurate",  benchmarkCase.sampleAccurate);
+        result->setProperty("parameter_changes", parameterChanges);
+        result->setProperty("compact_history",  benchmarkCase.compactHistory);
+        result->setProperty("history_bytes",    (int64)processor.getDelayHistoryBytes());
+        result->setProperty("worker_threads",   workerThreads);
+        result->setProperty("tile_size",        benchmarkCase.tileSize);
+        result->setProperty("tile_kib",         (double)numChannels * (benchmarkCase.tileSize > 0 ? jmin(benchmarkCase.tileSize, blockSize) : blockSize) * sizeof(FloatType) / 1024.0);
+        result->setProperty("blocks",           numBlocks);
+        result->setProperty("ns_per_sample",    totalNanoseconds / samplesProcessed);
+        result->setProperty("realtime_factor",  (samplesProcessed / sampleRate) / (totalNanoseconds * 1.0e-9));
+        // The block is read and written once per call from the host's point of view, whatever happens inside
+        result->setProperty("buffer_gb_per_s",  samplesProcessed * numChannels * sizeof(FloatType) * 2.0 / totalNanoseconds);
+        result->setProperty("block_us",         blockMicroseconds.get());
+
+       #if ATMOS_REALTIME_CHECKS
+        DynamicObject::Ptr violations = new DynamicObject();
+        violations->setProperty("allocations",      (int64)realtimeReport.counts[RealtimeSafety::allocation]);
+        violations->setProperty("deallocations",    (int64)realtimeReport.counts[RealtimeSafety::deallocation]);
+        violations->setProperty("locks",            (int64)realtimeReport.counts[RealtimeSafety::lock]);
+        violations->setProperty("system_calls",     (int64)realtimeReport.counts[RealtimeSafety::systemCall]);
+        result->setProperty("realtime_violations", violations.get());
+
+        if (realtimeReport.getTotal() > 0)
+            cerr << RealtimeSafety::describe(realtimeReport);
+       #else
+        ignoreUnused(realtimeReport);
+       #endif
+
+        return result.get();
+    }
+
+    void printUsage()
+    {
+        cout << "Atmos3DDelayBenchmark [options]" << endl
+             << "  --layouts=5.1,7.1.2,...          bus layouts to run: 5.1, 5.1.2, 5.1.4, 7.1, 7.1.2, 7.1.4, 9.1.6 (default 7.1.2)" << endl
+             << "  --sample-rates=44100,48000,...   sample rates to run (default 44100 to 192000)" << endl
+             << "  --block-sizes=16,32,...          block sizes to run (default 16 to 4096)" << endl
+             << "  --modes=0,1,2,3,4                delay modes to run: ping-pong, normal, midside, multi-tap, fdn (default all)" << endl
+             << "  --interpolation=0,1,2,3          interpolation indices to run: linear, hermite, lagrange, sinc (default 0)" << endl
+             << "  --seconds=2                      seconds of audio timed per case" << endl
+             << "  --warmup=32                      untimed blocks before each case" << endl
+             << "  --compact                        keep the delay history as 16-bit samples" << endl
+             << "  --parallel                       split filters and gains over worker threads on large layouts" << endl
+             << "  --tile-sizes=0,64                frames per processing tile, 0 running each stage over the whole block (default 64)" << endl
+             << "  --precision=float,double         host sample types to run; double also keeps the history in double (default float)" << endl
+             << "  --automation=lfo,steps,random    also replay automation of delayTime, lowpass, highpass, inGain and outGain:" << endl
+             << "                                   0.5 Hz sweeps, a step every quarter second or a random jump every block." << endl
+             << "                                   Each is compared with a static run of the same case (default static only)," << endl
+             << "                                   and the exit code is 3 if the processor's parameters never moved" << endl
+             << "  --sample-accurate                queue the automation every blockSize / 32 samples (at least 32) inside" << endl
+             << "                                   each block, instead of setting it once before the block. First checks" << endl
+             << "                                   that a queued change lands on its sample, exiting with code 4 if not" << endl
+             << "  --output=file.json               write the report to a file instead of stdout" << endl
+             << endl
+             << "Configured with -DATMOS_REALTIME_CHECKS=ON, each result also counts the allocations," << endl
+             << "locks and system calls made inside processBlock, and the exit code is 2 if any occur." << endl;
+    }
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    // The parameter tree runs a Timer, so a message manager has to exist even when headless
+    ScopedJuceInitialiser_GUI juceInitialiser;
+
+    ArgumentList args(argc, argv);
+
+    if (args.containsOption("--help|-h"))
+    {
+        printUsage();
+        return 0;
+    }
+
+    Array<AudioChannelSet> layouts;
+
+    for (auto& name : StringArray::fromTokens(args.getValueForOption("--layouts").isEmpty() ? String("7.1.2") : args.getValueForOption("--layouts"), ",", ""))
+    {
+        const auto layout = SpeakerLayout::getLayoutForName(name.trim());
+
+        if (layout.isDisabled())
+        {
+            cerr << "Unknown layout " << name << endl;
+            return 1;
+        }
+
+        layouts.add(layout);
+    }
+
+    const auto sampleRates = parseList(args.getValueForOption("--sample-rates"), { 44100, 48000, 88200, 96000, 176400, 192000 });
+    const auto blockSizes = parseList(args.getValueForOption("--block-sizes"), { 16, 32, 64, 128, 256, 512, 1024, 2048, 4096 });
+    const double seconds = args.containsOption("--seconds") ? args.getValueForOption("--seconds").getDoubleValue() : 2.0;
+    const int warmupBlocks = args.containsOption("--warmup") ? args.getValueForOption("--warmup").getIntValue() : 32;
+
+    int numModes = 0, numInterpolations = 0, defaultTileSize = 0;
+    {
+        Atmos3DDelayAudioProcessor processor;
+        defaultTileSize = processor.getTileSize();
+
+        numModes = getDelayModeNames(processor).size();
+
+        if (auto* choices = dynamic_cast<AudioParameterChoice*>(processor.parameters.getParameter("interpolation")))
+            numInterpolations = choices->choices.size();
+    }
+
+    Array<int> allModes;
+
+    for (int mode = 0; mode < numModes; ++mode)
+        allModes.add(mode);
+
+    // By default only layouts, rates, block sizes and modes multiply; the other axes stay at the processor's own
+    // settings unless asked for, so a plain run stays a few hundred cases
+    const auto modes = parseList(args.getValueForOption("--modes"), allModes, 0);
+    const auto interpolations = parseList(args.getValueForOption("--interpolation"), { 0 }, 0);
+    const bool compactHistory = args.containsOption("--compact");
+    const bool parallel = args.containsOption("--parallel");
+    const bool sampleAccurate = args.containsOption("--sample-accurate");
+
+    if (sampleAccurate)
+    {
+        bool landsOnItsSample = true;
+
+        for (auto offset : { 1, 37, 255 })
+            landsOnItsSample &= checkSampleAccurateChange(256, offset);
+
+        if (! landsOnItsSample)
+            return 4;
+    }
+    const auto tileSizes = parseList(args.getValueForOption("--tile-sizes"), { defaultTileSize }, 0);
+    const auto precisions = StringArray::fromTokens(args.getValueForOption("--precision").isEmpty() ? String("float")
+                                                                                                     : args.getValueForOption("--precision"), ",", "");
+
+    // Static parameters always run, first, as the baseline the automated runs of a case are compared with
+    Array<int> automations { staticParameters };
+
+    for (auto& name : StringArray::fromTokens(args.getValueForOption("--automation"), ",", ""))
+    {
+        const int automation = automationNames.indexOf(name.trim());
+
+        if (automation < 0)
+        {
+            cerr << "Unknown automation " << name << endl;
+            return 1;
+        }
+
+        automations.addIfNotAlreadyThere(automation);
+    }
+
+    Array<BenchmarkCase> cases;
+
+    for (auto& layout : layouts)
+        for (auto sampleRate : sampleRates)
+            for (auto mode : modes)
+                for (auto interpolation : interpolations)
+                    for (auto blockSize : blockSizes)
+                        for (auto tileSize : tileSizes)
+                            for (auto& precision : precisions)
+                                for (auto automation : automations)
+                                    if (isPositiveAndBelow(mode, numModes) && isPositiveAndBelow(interpolation, numInterpolations))
+                                        cases.add({ layout, (double)sampleRate, blockSize, mode, interpolation, compactHistory, parallel,
+                                                    tileSize, precision.trim() == "double", automation,
+                                                    sampleAccurate && automation != staticParameters });
+
+    Array<var> results;
+    var staticResult;
+    int64 totalViolations = 0;
+    int staticAutomatedCases = 0;
+
+    for (auto& benchmarkCase : cases)
+    {
+        cerr << benchmarkCase.layout.getSpeakerArrangementAsString() << ", sample rate " << benchmarkCase.sampleRate
+             << ", mode " << benchmarkCase.delayOption << ", interpolation " << benchmarkCase.interpolation
+             << ", block " << benchmarkCase.blockSize << ", tile " << benchmarkCase.tileSize
+             << ", " << (benchmarkCase.doublePrecision ? "double" : "float") << ", " << automationNames[benchmarkCase.automation] << endl;
+
+        auto result = benchmarkCase.doublePrecision ? runCase<double>(benchmarkCase, seconds, warmupBlocks)
+                                                    : runCase<float>(benchmarkCase, seconds, warmupBlocks);
+
+        if (result.isVoid())
+        {
+            cerr << "  layout not supported, skipped" << endl;
+            continue;
+        }
+
+        // Automated cases follow the static run of the same case
+        if (benchmarkCase.automation == staticParameters)
+        {
+            staticResult = result;
+        }
+        else if (auto* object = result.getDynamicObject())
+        {
+            object->setProperty("mean_vs_static", (double)result["block_us"]["mean"] / (double)staticResult["block_us"]["mean"]);
+            object->setProperty("max_vs_static",  (double)result["block_us"]["max"] / (double)staticResult["block_us"]["max"]);
+
+            if ((int64)result["parameter_changes"] == 0)
+            {
+                cerr << "  automation never changed the processor's parameters" << endl;
+                ++staticAutomatedCases;
+            }
+        }
+
+        if (auto* violations = result["realtime_violations"].getDynamicObject())
+            for (auto& property : violations->getProperties())
+                totalViolations += (int64)property.value;
+
+        results.add(result);
+    }
+
+    DynamicObject::Ptr report = new DynamicObject();
+    report->setProperty("benchmark",    "processBlock");
+    report->setProperty("plugin",       JucePlugin_Name);
+    report->setProperty("juce_version", SystemStats::getJUCEVersion());
+    report->setProperty("cpu",          SystemStats::getCpuModel());
+    report->setProperty("os",           SystemStats::getOperatingSystemName());
+   #if JUCE_DEBUG
+    report->setProperty("build",        "debug");
+   #else
+    report->setProperty("build",        "release");
+   #endif
+    report->setProperty("seconds_per_case", seconds);
+    report->setProperty("realtime_checks", ATMOS_REALTIME_CHECKS != 0);
+    report->setProperty("results",      results);
+
+    const auto json = JSON::toString(report.get());
+
+    if (args.containsOption("--output"))
+    {
+        const File outputFile = File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--output"));
+
+        if (! outputFile.replaceWithText(json))
+        {
+            cerr << "Could not write " << outputFile.getFullPathName() << endl;
+            return 1;
+        }
+    }
+    else
+    {
+        cout << json << endl;
+    }
+
+    // A distinct exit code so CI can fail on real-time violations separately from I/O errors
+    if (totalViolations > 0)
+    {
+        cerr << totalViolations << " real-time violations inside processBlock" << endl;
+        return 2;
+    }
+
+    if (staticAutomatedCases > 0)
+    {
+        cerr << staticAutomatedCases << " automated cases ran with static parameters" << endl;
+        return 3;
+    }
+
+    return 0;
+}
@@ -0,0 +1,169 @@
+/*
+  ==============================================================================
+
+    BinaryState.h
+    Compact, versioned binary form of the plugin state for host sessions.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ParameterSnapshot.h"
+#include "TapPattern.h"
+
+using namespace juce;
+
+//==============================================================================
+/** Everything getStateInformation saves, in plain fields. */
+struct SavedState
+{
+    ParameterSnapshot   values;
+    bool                compactHistory = false, parallelProcessing = false, bypassRingOut = false;
+    int                 program = 0;
+    TapPattern          tapPattern = TapPattern::createDefault();
+};
+
+//==============================================================================
+/**
+    Writes a SavedState as a few hundred bytes of little-endian binary, and
+    reads it back without building a ValueTree or parsing any XML:
+
+        uint32  magic, "A3DB"
+        uint16  version
+        uint8   parameter count, then per parameter: uint32 hash of its ID, float32 value
+        uint8   flags: compact history, parallel processing, bypass ring-out
+        int16   current program
+        uint8   tap count, then per tap: time, gain, feedback, azimuth, elevation as float32
+
+    Parameters are keyed by ID, so they can be added, removed or reordered;
+    ones missing from a blob keep whatever value the caller started with.
+    Later versions only append fields, so an older reader can still load the
+    part it knows. Version 2 moved Multi-Tap and FDN from delay_option, where
+    version 1 saved them as its fourth and fifth choices, to delay_network;
+    read() moves them across.
+*/
+struct BinaryState
+{
+    static constexpr uint32 magic = 0x42443341;         // "A3DB" as it appears in the first four bytes
+    static constexpr int version = 2;
+
+    static bool isBinaryState(const void* data, int sizeInBytes) noexcept
+    {
+        return sizeInBytes >= 6 && ByteOrder::littleEndianInt(data) == magic;
+    }
+
+    static void write(const SavedState& state, MemoryBlock& destData)
+    {
+        MemoryOutputStream stream(destData, false);
+
+        stream.writeInt((int)magic);
+        stream.writeShort((short)version);
+
+        stream.writeByte((char)ParameterSnapshot::numParameters);
+
+        for (int i = 0; i < ParameterSnapshot::numParameters; ++i)
+        {
+            stream.writeInt(getIDHash(i));
+            stream.writeFloat(state.values.getValue(i));
+        }
+
+        stream.writeByte((char)((state.compactHistory ? 1 : 0) | (state.parallelProcessing ? 2 : 0) | (state.bypassRingOut ? 4 : 0)));
+        stream.writeShort((short)state.program);
+
+        const auto& pattern = state.tapPattern;
+        stream.writeByte((char)pattern.numTaps);
+
+        for (int i = 0; i < pattern.numTaps; ++i)
+            for (auto field : { pattern.taps[i].time, pattern.taps[i].gain, pattern.taps[i].feedback, pattern.taps[i].azimuth, pattern.taps[i].elevation })
+                stream.writeFloat(field);
+    }
+
+    /** Fills state from a blob, returning false if it is not one of ours. Fields the blob lacks are left alone. */
+    static bool read(const void* data, int sizeInBytes, SavedState& state)
+    {
+        if (! isBinaryState(data, sizeInBytes))
+            return false;
+
+        MemoryInputStream stream(data, (size_t)sizeInBytes, false);
+        stream.readInt();
+
+        // A newer writer may only have appended, so its blobs still read
+        const int blobVersion = stream.readShort();
+
+        if (blobVersion < 1)
+            return false;
+
+        const int numParameters = (uint8)stream.readByte();
+
+        for (int i = 0; i < numParameters && ! stream.isExhausted(); ++i)
+        {
+            const int hash = stream.readInt();
+            const float value = stream.readFloat();
+
+            for (int index = 0; index < ParameterSnapshot::numParameters; ++index)
+                if (getIDHash(index) == hash && std::isfinite(value))
+                    state.values.setValue(index, value);
+        }
+
+        if (blobVersion < 2)
+            migrateDelayOption(state.values);
+
+        if (stream.isExhausted())
+            return true;
+
+        const int flags = (uint8)stream.readByte();
+        state.compactHistory        = (flags & 1) != 0;
+        state.parallelProcessing    = (flags & 2) != 0;
+        state.bypassRingOut         = (flags & 4) != 0;
+        state.program               = stream.readShort();
+
+        if (stream.isExhausted())
+            return true;
+
+        TapPattern pattern;
+        const int numTaps = (uint8)stream.readByte();
+
+        for (int i = 0; i < numTaps && stream.getNumBytesRemaining() >= 5 * (int64)sizeof(float); ++i)
+        {
+            // Same limits as a pattern loaded from XML
+            EchoTap tap;
+            tap.time        = jlimit(0.0f, 1.0f, stream.readFloat());
+            tap.gain        = jlimit(0.0f, 2.0f, stream.readFloat());
+            tap.feedback    = jlimit(0.0f, 1.0f, stream.readFloat());
+            tap.azimuth     = stream.readFloat();
+            tap.elevation   = jlimit(-90.0f, 90.0f, stream.readFloat());
+
+            if (! pattern.addTap(tap))
+                break;
+        }
+
+        state.tapPattern = pattern;
+        return true;
+    }
+
+    /** Moves a mode saved as a delay_option past the three it has now over to delay_network. */
+    static void migrateDelayOption(ParameterSnapshot& values) noexcept
+    {
+        if (values.delayOption >= ParameterSnapshot::numDelayOptions)
+            values.setDelayMode(values.delayOption);
+    }
+
+private:
+    // The same on every platform and build: String::hashCode is defined on the characters alone
+    static int getIDHash(int index)
+    {
+        static const auto hashes = []
+        {
+            std::array<int, ParameterSnapshot::numParameters> table;
+
+            for (int i = 0; i < ParameterSnapshot::numParameters; ++i)
+                table[(size_t)i] = String(ParameterSnapshot::parameterIDs[i]).hashCode();
+
+            return table;
+        }();
+
+        return hashes[(size_t)index];
+    }
+};
@@ -0,0 +1,583 @@
+/*
+  ==============================================================================
+
+    DelayKernel.h
+    Vectorised read / mix / feedback loop shared by every delay mode.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "DelayLine.h"
+#include "SpeakerLayout.h"
+
+//==============================================================================
+/**
+    A network of up to maxTaps read heads over a DelayLine, rebuilt by a delay
+    mode when its parameters move. Each tap reads one history lane at its own
+    delay and sends what it reads to every output lane and every history lane
+    through two gain vectors, so a tap's "position" is just its output gains.
+    Every per-lane table is laid out like a DelayLine frame, indexed by lane,
+    so the kernel can load it straight into SIMD registers.
+
+    Output lanes are the host channels' lanes from the SpeakerLayout. History
+    lanes are storage: the presets keep each speaker's own echo in its lane,
+    the multi-tap mode keeps the input sides in the first few.
+
+    For each output/history lane l:
+        echo     = sum over taps t of tapOutput[t][l] * tap t
+        output   = dryLeft[l] * left + dryRight[l] * right + wet[l] * echo
+        history  = writeLeft[l] * left + writeRight[l] * right + damping(sum over taps t of tapFeedback[t][l] * tap t)
+
+    The damping is a one-pole lowpass followed by a one-pole highpass on each
+    history lane, so every repeat comes back a little darker and thinner than
+    the last. Its state is kept in the DelayLine.
+
+    A feedback delay network sets setFeedbackMix() instead of tapFeedback: tap
+    t then reads lane t, and the history takes H * (mixGain * taps), where H
+    is an orthonormal Hadamard matrix applied with the fast transform, so
+    every line feeds every other in N log N operations rather than N squared.
+*/
+struct DelayRouting
+{
+    static constexpr int maxChannels = SpeakerLayout::maxChannels;
+    static constexpr int maxTaps = 32;
+
+    int     numTaps = 0;
+    float   tapDelay[maxTaps] {};                                       // Read head delays in samples
+    int     tapLane[maxTaps] {};                                        // History lane each tap reads
+
+    alignas(DelayLine::alignment) float tapOutput[maxTaps][maxChannels] {};
+    alignas(DelayLine::alignment) float tapFeedback[maxTaps][maxChannels] {};
+    alignas(DelayLine::alignment) float dryLeft[maxChannels] {};
+    alignas(DelayLine::alignment) float dryRight[maxChannels] {};
+    alignas(DelayLine::alignment) float wet[maxChannels] {};
+    alignas(DelayLine::alignment) float writeLeft[maxChannels] {};
+    alignas(DelayLine::alignment) float writeRight[maxChannels] {};
+    alignas(DelayLine::alignment) float mixGain[maxChannels] {};      // Per-line feedback gain ahead of the Hadamard mix
+
+    // Damping stages as state = coefficient * input + hold * state; the highpass output is its input less that state
+    alignas(DelayLine::alignment) float lowpassCoefficient[maxChannels] {};
+    alignas(DelayLine::alignment) float lowpassHold[maxChannels] {};
+    alignas(DelayLine::alignment) float highpassCoefficient[maxChannels] {};
+    alignas(DelayLine::alignment) float highpassHold[maxChannels] {};
+
+    int     mixSize = 0;                                                // Hadamard size, or 0 when tapFeedback is used
+    int     numMixLanes = 0;
+    float   mixScale = 1.0f;                                            // Normalises each transform to unit gain
+
+    int     numOutputs = 0;
+    int     outputLanes[maxChannels] {};                                // Lanes written back to the host buffer...
+    int     outputChannels[maxChannels] {};                             // ...and the channels they go to
+    int     inputLeft = 0, inputRight = 1;                              // Channels holding the stereo input
+
+    void reset(const SpeakerLayout& speakerLayout) noexcept
+    {
+        *this = DelayRouting();
+        layout = &speakerLayout;
+        inputLeft = speakerLayout.inputLeft;
+        inputRight = speakerLayout.inputRight;
+
+        for (int lane = 0; lane < maxChannels; ++lane)
+        {
+            laneTap[lane] = -1;
+            laneFeedbackSource[lane] = lane;
+        }
+
+        setDamping(1.0f, 0.0f);
+    }
+
+    int getLane(int channel) const noexcept
+    {
+        jassert(layout != nullptr && isPositiveAndBelow(channel, layout->numChannels));
+        return layout->speakers[channel].lane;
+    }
+
+    /** Adds a read head on a history lane, returning its index, or -1 once maxTaps are in use. */
+    int addTap(float delayInSamples, int lane) noexcept
+    {
+        jassert(isPositiveAndBelow(lane, maxChannels));
+
+        if (numTaps >= maxTaps)
+            return -1;
+
+        tapDelay[numTaps] = delayInSamples;
+        tapLane[numTaps] = lane;
+        return numTaps++;
+    }
+
+    /** Delay of the furthest read head, in samples. */
+    float getLongestDelay() const noexcept
+    {
+        float longest = 0.0f;
+
+        for (int tap = 0; tap < numTaps; ++tap)
+            longest = jmax(longest, tapDelay[tap]);
+
+        return longest;
+    }
+
+    /** Dry input and wet level of an output channel, which must have a lane. Each channel is set once. */
+    void setOutput(int channel, float leftDry, float rightDry, float wetGain) noexcept
+    {
+        const int lane = getLane(channel);
+        jassert(lane >= 0);
+
+        dryLeft[lane]                   = leftDry;
+        dryRight[lane]                  = rightDry;
+        wet[lane]                       = wetGain;
+        outputLanes[numOutputs]         = lane;
+        outputChannels[numOutputs++]    = channel;
+    }
+
+    void setHistoryInput(int lane, float left, float right) noexcept
+    {
+        writeLeft[lane] = left;
+        writeRight[lane] = right;
+    }
+
+    /**
+        One-pole coefficients of the feedback damping on every lane, from 0 to 1.
+        A lowpass of 1 and a highpass of 0 pass the repeats through bit for bit.
+    */
+    void setDamping(float lowpass, float highpass) noexcept
+    {
+        if (lowpassCoefficient[0] != lowpass || highpassCoefficient[0] != highpass)
+            wideGainsCurrent = false;
+
+        for (int lane = 0; lane < maxChannels; ++lane)
+        {
+            lowpassCoefficient[lane]    = lowpass;
+            lowpassHold[lane]           = 1.0f - lowpass;
+            highpassCoefficient[lane]   = highpass;
+            highpassHold[lane]          = 1.0f - highpass;
+        }
+    }
+
+    /**
+        Feeds the first numLanes taps, each of which must read its own lane,
+        back through a Hadamard mix. numLanes that are not a power of two are
+        mixed by two overlapping transforms of the largest power of two below,
+        one over the first lanes and one over the last; each is orthogonal, so
+        their product is too and the loop gain is set by mixGain alone.
+    */
+    void setFeedbackMix(int numLanes) noexcept
+    {
+        jassert(numTaps == numLanes && isPositiveAndNotGreaterThan(numLanes, maxChannels));
+
+        for (int tap = 0; tap < numTaps; ++tap)
+            jassert(tapLane[tap] == tap);
+
+        numMixLanes = numLanes;
+        mixSize = numLanes > 1 ? (int)nextPowerOfTwo(numLanes + 1) / 2 : 0;
+        mixScale = mixSize > 0 ? 1.0f / std::sqrt((float)mixSize) : 1.0f;
+    }
+
+    //==============================================================================
+    /**
+        One echo per speaker, read from the speaker's own lane: the layout the
+        Ping-Pong, Normal and MidSide presets are written in. The channel's
+        history takes feedbackGain times the echo of source (both host channel
+        indices), whichever of the two is set first.
+    */
+    void setChannel(int channel, float delayInSamples, float leftInput, float rightInput, float dry, float wetGain,
+                    float historyLeft, float historyRight, float feedbackGain, int source) noexcept
+    {
+        const int lane = getLane(channel);
+        const int sourceLane = getLane(source);
+        jassert(lane >= 0 && sourceLane >= 0);
+
+        const int tap = addTap(delayInSamples, lane);
+        jassert(tap >= 0);
+
+        tapOutput[tap][lane] = 1.0f;
+        setOutput(channel, dry * leftInput, dry * rightInput, wetGain);
+        setHistoryInput(lane, historyLeft, historyRight);
+
+        laneTap[lane] = tap;
+        laneFeedbackSource[lane] = sourceLane;
+        laneFeedbackGain[lane] = feedbackGain;
+
+        if (laneTap[sourceLane] >= 0)
+            tapFeedback[laneTap[sourceLane]][lane] = feedbackGain;
+
+        for (int other = 0; other < maxChannels; ++other)
+            if (other != lane && laneTap[other] >= 0 && laneFeedbackSource[other] == lane)
+                tapFeedback[tap][other] = laneFeedbackGain[other];
+    }
+
+    //==============================================================================
+    /** The gain tables in double, for kernels running on a float64 history. */
+    struct WideGains
+    {
+        static constexpr int numTables = 10;
+
+        alignas(DelayLine::alignment) double tapOutput[maxTaps][maxChannels];
+        alignas(DelayLine::alignment) double tapFeedback[maxTaps][maxChannels];
+        alignas(DelayLine::alignment) double tables[numTables][maxChannels];   // The per-lane tables, in declaration order
+        double mixScale;
+    };
+
+    /**
+        Brings the double copy of the tables up to date. Only does the copy
+        when reset() or a new setDamping() has been through since the last
+        call, so it is cheap to call every block once the routing is built.
+    */
+    void widenGains() noexcept
+    {
+        if (wideGainsCurrent)
+            return;
+
+        for (int tap = 0; tap < numTaps; ++tap)
+        {
+            for (int lane = 0; lane < maxChannels; ++lane)
+            {
+                wideGains.tapOutput[tap][lane] = tapOutput[tap][lane];
+                wideGains.tapFeedback[tap][lane] = tapFeedback[tap][lane];
+            }
+        }
+
+        const float* sources[WideGains::numTables] = { dryLeft, dryRight, wet, writeLeft, writeRight, mixGain,
+                                                       lowpassCoefficient, lowpassHold, highpassCoefficient, highpassHold };
+
+        for (int table = 0; table < WideGains::numTables; ++table)
+            for (int lane = 0; lane < maxChannels; ++lane)
+                wideGains.tables[table][lane] = sources[table][lane];
+
+        wideGains.mixScale = mixScale;
+        wideGainsCurrent = true;
+    }
+
+    const WideGains& getWideGains() const noexcept
+    {
+        jassert(wideGainsCurrent);
+        return wideGains;
+    }
+
+private:
+    const SpeakerLayout* layout = nullptr;
+
+    // Rows past numTaps are left stale; the kernels never read them
+    WideGains   wideGains;
+    bool        wideGainsCurrent = false;
+
+    // Bookkeeping for setChannel only
+    int     laneTap[maxChannels] {};
+    int     laneFeedbackSource[maxChannels] {};
+    float   laneFeedbackGain[maxChannels] {};
+};
+
+//==============================================================================
+/**
+    A DelayRouting's gain tables in the arithmetic type of a kernel. Float
+    kernels read the routing in place, double ones its widened copy.
+*/
+template <typename Value>
+struct DelayGains
+{
+    explicit DelayGains(const DelayRouting& routing) noexcept
+        : dryLeft(routing.dryLeft), dryRight(routing.dryRight), wet(routing.wet),
+          writeLeft(routing.writeLeft), writeRight(routing.writeRight), mixGain(routing.mixGain),
+          lowpassCoefficient(routing.lowpassCoefficient), lowpassHold(routing.lowpassHold),
+          highpassCoefficient(routing.highpassCoefficient), highpassHold(routing.highpassHold),
+          mixScale(routing.mixScale),
+          tapOutputs(&routing.tapOutput[0][0]), tapFeedbacks(&routing.tapFeedback[0][0])
+    {
+    }
+
+    const Value* tapOutput(int tap) const noexcept      { return tapOutputs + tap * DelayRouting::maxChannels; }
+    const Value* tapFeedback(int tap) const noexcept    { return tapFeedbacks + tap * DelayRouting::maxChannels; }
+
+    const Value *dryLeft, *dryRight, *wet, *writeLeft, *writeRight, *mixGain;
+    const Value *lowpassCoefficient, *lowpassHold, *highpassCoefficient, *highpassHold;
+    Value mixScale;
+
+private:
+    const Value *tapOutputs, *tapFeedbacks;
+};
+
+/** Double kernels read the routing's widened copy, which widenGains() must have brought up to date. */
+template <>
+struct DelayGains<double>
+{
+    explicit DelayGains(const DelayRouting& routing) noexcept
+        : gains(routing.getWideGains()), mixScale(gains.mixScale)
+    {
+    }
+
+    const double* tapOutput(int tap) const noexcept     { return gains.tapOutput[tap]; }
+    const double* tapFeedback(int tap) const noexcept   { return gains.tapFeedback[tap]; }
+
+private:
+    const DelayRouting::WideGains& gains;
+
+public:
+    const double *dryLeft = gains.tables[0], *dryRight = gains.tables[1], *wet = gains.tables[2], *writeLeft = gains.tables[3];
+    const double *writeRight = gains.tables[4], *mixGain = gains.tables[5];
+    const double *lowpassCoefficient = gains.tables[6], *lowpassHold = gains.tables[7];
+    const double *highpassCoefficient = gains.tables[8], *highpassHold = gains.tables[9];
+    double mixScale;
+};
+
+//==============================================================================
+/**
+    Runs one block of a DelayRouting over a DelayLine. Each sample first
+    gathers the frames under every tap into one array per interpolation
+    point, runs the interpolation filter over a register of taps at a time,
+    then accumulates the taps into all output and history lanes with SIMD
+    multiply-adds; only the final store to the host's channel buffers is
+    done per channel.
+
+    The history sample type, host sample type, frame width and interpolator
+    width are template arguments, so each bus layout gets a kernel whose
+    register loops are fully unrolled; the tap count varies at run time.
+    select() picks the matching instantiation. The interpolation weights are
+    resolved once per block. The arithmetic is in double when the history is
+    float64, and in float otherwise, whatever the host's sample type.
+
+    Routings with a Hadamard feedback mix get their own instantiations, which
+    skip the tapFeedback matrix and run the fast transform on the tap values.
+
+    The stereo input is read from routing.inputLeft/inputRight before they are overwritten.
+*/
+struct DelayKernel
+{
+    template <typename FloatType>
+    using Function = void (*)(DelayLine&, const DelayRouting&, const Interpolator&, FloatType* const*, int) noexcept;
+
+    // Frame strides are whole float registers, which are always whole double registers too
+    static constexpr int frameLanes = (int)DelayLine::Register::size();
+    static constexpr int maxFrameRegisters = (DelayRouting::maxChannels + frameLanes - 1) / frameLanes;
+
+    template <typename FloatType>
+    static Function<FloatType> select(DelayLine::Format format, int frameStride, int numPoints, bool mixedFeedback = false) noexcept;
+
+    template <typename Sample, typename FloatType, int numFrameRegisters, int numPoints, bool mixedFeedback>
+    static void process(DelayLine& line, const DelayRouting& routing, const Interpolator& interpolator,
+                        FloatType* const* channels, int numSamples) noexcept
+    {
+        using Value = typename std::conditional<std::is_same<Sample, double>::value, double, float>::type;
+        using Register = dsp::SIMDRegister<Value>;
+
+        constexpr int lanes = (int)Register::size();
+        constexpr int stride = numFrameRegisters * frameLanes;
+        constexpr int numRegisters = stride / lanes;
+        constexpr Value sampleScale = std::is_same<Sample, int16>::value ? (Value)DelayLine::compactHeadroom / (Value)32767 : (Value)1;
+
+        static_assert(stride % lanes == 0, "Frames must hold whole registers");
+        jassert(line.getFrameStride() == stride && interpolator.getNumPoints() == numPoints);
+        jassert(mixedFeedback == (routing.mixSize > 0));
+
+        const int numTaps = routing.numTaps;
+        const int numTapRegisters = (numTaps + lanes - 1) / lanes;
+        const DelayGains<Value> gains(routing);
+
+        // Interpolation weights per point, tap-major so a register of taps loads at once. The compact
+        // format's scale is folded in, and taps past numTaps keep zero weights.
+        DelayLine::Tap taps[DelayRouting::maxTaps];
+        alignas(DelayLine::alignment) Value weights[numPoints][DelayRouting::maxTaps] {};
+        alignas(DelayLine::alignment) Value gathered[numPoints][DelayRouting::maxTaps] {};
+
+        for (int tap = 0; tap < numTaps; ++tap)
+        {
+            float tapWeights[numPoints];
+
+            taps[tap] = line.makeTap(routing.tapDelay[tap], numPoints);
+            interpolator.getWeights(taps[tap].fraction, tapWeights);
+
+            for (int point = 0; point < numPoints; ++point)
+                weights[point][tap] = (Value)tapWeights[point] * sampleScale;
+        }
+
+        alignas(DelayLine::alignment) Value tapValues[DelayRouting::maxTaps] {};
+        alignas(DelayLine::alignment) Value outputFrame[stride];
+        alignas(DelayLine::alignment) Value historyFrame[stride];
+
+        const FloatType* leftData = channels[routing.inputLeft];
+        const FloatType* rightData = channels[routing.inputRight];
+
+        // The damping filters run in registers for the whole block
+        Value* lowpassStore = line.getFilterState<Value>(0);
+        Value* highpassStore = line.getFilterState<Value>(1);
+        Register lowpassState[numRegisters], highpassState[numRegisters];
+
+        for (int r = 0; r < numRegisters; ++r)
+        {
+            lowpassState[r] = Register::fromRawArray(lowpassStore + r * lanes);
+            highpassState[r] = Register::fromRawArray(highpassStore + r * lanes);
+        }
+
+        for (int sample = 0; sample < numSamples; ++sample)
+        {
+            // Gather: the frames under each tap, from its own lane
+            for (int tap = 0; tap < numTaps; ++tap)
+            {
+                const Sample* frame = line.getReadFrame<Sample>(taps[tap]) + routing.tapLane[tap];
+
+                for (int point = 0; point < numPoints; ++point)
+                    gathered[point][tap] = (Value)frame[point * stride];
+            }
+
+            // Interpolate a register of taps at a time
+            for (int r = 0; r < numTapRegisters; ++r)
+            {
+                const int tap = r * lanes;
+                Register value = Register::fromRawArray(weights[0] + tap) * Register::fromRawArray(gathered[0] + tap);
+
+                for (int point = 1; point < numPoints; ++point)
+                    value += Register::fromRawArray(weights[point] + tap) * Register::fromRawArray(gathered[point] + tap);
+
+                value.copyToRawArray(tapValues + tap);
+            }
+
+            Register echo[numRegisters], feedback[numRegisters];
+
+            for (int r = 0; r < numRegisters; ++r)
+                echo[r] = feedback[r] = Register::expand((Value)0);
+
+            for (int tap = 0; tap < numTaps; ++tap)
+            {
+                const Register value = Register::expand(tapValues[tap]);
+
+                for (int r = 0; r < numRegisters; ++r)
+                {
+                    echo[r] += value * Register::fromRawArray(gains.tapOutput(tap) + r * lanes);
+
+                    if constexpr (! mixedFeedback)
+                        feedback[r] += value * Register::fromRawArray(gains.tapFeedback(tap) + r * lanes);
+                }
+            }
+
+            // Tap t is line t here, so the tap values are already a history frame
+            if constexpr (mixedFeedback)
+            {
+                alignas(DelayLine::alignment) Value mixFrame[stride];
+
+                for (int r = 0; r < numRegisters; ++r)
+                    (Register::fromRawArray(tapValues + r * lanes) * Register::fromRawArray(gains.mixGain + r * lanes)).copyToRawArray(mixFrame + r * lanes);
+
+                hadamard(mixFrame, routing.mixSize, gains.mixScale);
+
+                if (routing.numMixLanes > routing.mixSize)
+                    hadamard(mixFrame + routing.numMixLanes - routing.mixSize, routing.mixSize, gains.mixScale);
+
+                for (int r = 0; r < numRegisters; ++r)
+                    feedback[r] = Register::fromRawArray(mixFrame + r * lanes);
+            }
+
+            const Register left = Register::expand((Value)leftData[sample]);
+            const Register right = Register::expand((Value)rightData[sample]);
+
+            for (int r = 0; r < numRegisters; ++r)
+            {
+                const int lane = r * lanes;
+
+                const Register output = Register::fromRawArray(gains.dryLeft + lane) * left
+                                      + Register::fromRawArray(gains.dryRight + lane) * right
+                                      + Register::fromRawArray(gains.wet + lane) * echo[r];
+
+                lowpassState[r] = Register::fromRawArray(gains.lowpassCoefficient + lane) * feedback[r]
+                                + Register::fromRawArray(gains.lowpassHold + lane) * lowpassState[r];
+                highpassState[r] = Register::fromRawArray(gains.highpassCoefficient + lane) * lowpassState[r]
+                                 + Register::fromRawArray(gains.highpassHold + lane) * highpassState[r];
+
+                const Register history = Register::fromRawArray(gains.writeLeft + lane) * left
+                                       + Register::fromRawArray(gains.writeRight + lane) * right
+                                       + (lowpassState[r] - highpassState[r]);
+
+                output.copyToRawArray(outputFrame + lane);
+
+                if constexpr (std::is_same<Sample, int16>::value)
+                {
+                    history.copyToRawArray(historyFrame + lane);
+                }
+                else
+                {
+                    history.copyToRawArray(line.getWriteFrame<Sample>() + lane);
+                    history.copyToRawArray(line.getMirrorFrame<Sample>() + lane);
+                }
+            }
+
+            if constexpr (std::is_same<Sample, int16>::value)
+            {
+                DelayLine::encode(historyFrame, line.getWriteFrame<int16>(), stride);
+                DelayLine::encode(historyFrame, line.getMirrorFrame<int16>(), stride);
+            }
+
+            for (int output = 0; output < routing.numOutputs; ++output)
+                channels[routing.outputChannels[output]][sample] = (FloatType)outputFrame[routing.outputLanes[output]];
+
+            line.advance();
+        }
+
+        for (int r = 0; r < numRegisters; ++r)
+        {
+            lowpassState[r].copyToRawArray(lowpassStore + r * lanes);
+            highpassState[r].copyToRawArray(highpassStore + r * lanes);
+        }
+    }
+
+private:
+    /** Fast Walsh-Hadamard transform of size values in place, a power of two, scaled by scale. */
+    template <typename Value>
+    static void hadamard(Value* values, int size, Value scale) noexcept
+    {
+        for (int half = 1; half < size; half *= 2)
+        {
+            for (int start = 0; start < size; start += 2 * half)
+            {
+                for (int i = start; i < start + half; ++i)
+                {
+                    const Value a = values[i], b = values[i + half];
+                    values[i] = a + b;
+                    values[i + half] = a - b;
+                }
+            }
+        }
+
+        for (int i = 0; i < size; ++i)
+            values[i] *= scale;
+    }
+
+    template <typename Sample, typename FloatType, int numPoints, bool mixedFeedback, size_t... indices>
+    static constexpr std::array<Function<FloatType>, sizeof...(indices)> makeTable(std::index_sequence<indices...>) noexcept
+    {
+        return { { &process<Sample, FloatType, (int)indices + 1, numPoints, mixedFeedback>... } };
+    }
+
+    template <typename Sample, typename FloatType, bool mixedFeedback>
+    static Function<FloatType> selectFor(int numFrameRegisters, int numPoints) noexcept;
+};
+
+template <typename Sample, typename FloatType, bool mixedFeedback>
+inline DelayKernel::Function<FloatType> DelayKernel::selectFor(int numFrameRegisters, int numPoints) noexcept
+{
+    using Registers = std::make_index_sequence<(size_t)maxFrameRegisters>;
+
+    static constexpr auto twoPoint = makeTable<Sample, FloatType, 2, mixedFeedback>(Registers());
+    static constexpr auto fourPoint = makeTable<Sample, FloatType, 4, mixedFeedback>(Registers());
+    static constexpr auto eightPoint = makeTable<Sample, FloatType, Interpolator::maxPoints, mixedFeedback>(Registers());
+
+    const auto& table = numPoints == 2 ? twoPoint : (numPoints == 4 ? fourPoint : eightPoint);
+    return table[(size_t)numFrameRegisters - 1];
+}
+
+template <typename FloatType>
+inline DelayKernel::Function<FloatType> DelayKernel::select(DelayLine::Format format, int frameStride, int numPoints, bool mixedFeedback) noexcept
+{
+    const int numFrameRegisters = frameStride / frameLanes;
+    jassert(frameStride % frameLanes == 0 && isPositiveAndNotGreaterThan(numFrameRegisters, maxFrameRegisters));
+    jassert(numPoints == 2 || numPoints == 4 || numPoints == Interpolator::maxPoints);
+
+    if (format == DelayLine::Format::int16)
+        return mixedFeedback ? selectFor<int16, FloatType, true>(numFrameRegisters, numPoints)
+                             : selectFor<int16, FloatType, false>(numFrameRegisters, numPoints);
+
+    if (format == DelayLine::Format::float64)
+        return mixedFeedback ? selectFor<double, FloatType, true>(numFrameRegisters, numPoints)
+                             : selectFor<double, FloatType, false>(numFrameRegisters, numPoints);
+
+    return mixedFeedback ? selectFor<float, FloatType, true>(numFrameRegisters, numPoints)
+                         : selectFor<float, FloatType, false>(numFrameRegisters, numPoints);
+}
@@ -0,0 +1,297 @@
+/*
+  ==============================================================================
+
+    DelayLine.h
+    Multichannel ring buffer shared by every delay mode.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "Interpolation.h"
+
+using namespace juce;
+
+//==============================================================================
+/**
+    Delay history for all delayed channels, stored frame-major.
+
+    One frame holds one sample of every channel, padded to a whole number of
+    SIMD registers, so a single tap read loads all channels at once. The length
+    is rounded up to a power of two so positions wrap with a mask, and a few
+    guard frames after the end repeat the start of the buffer, so a frame and
+    the ones after it can always be read without a wrap check. There are as
+    many guard frames as the widest interpolator has points.
+
+    Samples are kept either as floats or, in the compact format, as 16-bit
+    fixed point with compactHeadroom of headroom above full scale. That halves
+    the footprint at the cost of quantisation error around -84 dBFS in the echoes.
+    The float64 format doubles it instead, so long high-feedback tails run in
+    double precision all the way round the loop.
+*/
+class DelayLine
+{
+public:
+    using Register = dsp::SIMDRegister<float>;
+
+    enum class Format
+    {
+        float32,
+        int16,
+        float64
+    };
+
+    static constexpr size_t alignment = Register::SIMDRegisterSize;
+    static constexpr int guardFrames = Interpolator::maxPoints;
+    static constexpr float compactHeadroom = 4.0f;
+    static constexpr int numFilterStages = 2;
+
+    /** Read head resolved once per block from a delay time in samples. */
+    struct Tap
+    {
+        int     offset      = 0;        // Distance from the write position to the first frame read, before wrapping
+        float   fraction    = 0.0f;     // Position past the middle frame, between 0 and 1
+    };
+
+    void prepare(int numChannels, int maxDelaySamples, Format newFormat = Format::float32)
+    {
+        channels = numChannels;
+        format = newFormat;
+        frameStride = (int)(((size_t)numChannels + Register::size() - 1) / Register::size() * Register::size());
+
+        size = nextPowerOfTwo(jmax(maxDelaySamples + Interpolator::maxPoints, guardFrames));
+        mask = size - 1;
+
+        // One spare frame past the guard takes the mirror writes that are not needed
+        storage.calloc(getNumBytes() + alignment);
+        frames = align(storage.get());
+
+        filterStorage.calloc(getFilterStateBytes() + alignment);
+        filterState = align(filterStorage.get());
+        clear();
+    }
+
+    void clear()
+    {
+        zeromem(frames, getNumBytes());
+        zeromem(filterState, getFilterStateBytes());
+        writePosition = 0;
+    }
+
+    /**
+        Places a read head spanning numPoints frames. Delays are clamped so every
+        frame with a non-zero weight has been written: at least numPoints / 2
+        samples, at most the buffer length less that.
+    */
+    Tap makeTap(float delayInSamples, int numPoints = 2) const noexcept
+    {
+        jassert(isPositiveAndNotGreaterThan(numPoints, guardFrames) && numPoints % 2 == 0);
+
+        const int halfPoints = numPoints / 2;
+        const float position = (float)size - jlimit((float)halfPoints, (float)(size - halfPoints), delayInSamples);
+        const int middle = (int)position;
+
+        Tap tap;
+        tap.offset = middle - (halfPoints - 1);
+        tap.fraction = position - (float)middle;
+        return tap;
+    }
+
+    int getNumChannels() const noexcept     { return channels; }
+    int getFrameStride() const noexcept     { return frameStride; }
+    Format getFormat() const noexcept       { return format; }
+
+    /** Bytes of history held, excluding alignment slack. */
+    size_t getNumBytes() const noexcept
+    {
+        return (size_t)((size + guardFrames + 1) * frameStride) * getSampleBytes(format);
+    }
+
+    /** First of the frames a tap interpolates over; each of the others is frameStride samples after the last. */
+    template <typename Sample>
+    const Sample* getReadFrame(const Tap& tap) const noexcept
+    {
+        return getFrames<Sample>() + ((writePosition + tap.offset) & mask) * frameStride;
+    }
+
+    /** Frame at the write head. */
+    template <typename Sample>
+    Sample* getWriteFrame() noexcept
+    {
+        return getFrames<Sample>() + writePosition * frameStride;
+    }
+
+    /** Guard copy of the write frame, or the spare frame when the write head is past the guard. */
+    template <typename Sample>
+    Sample* getMirrorFrame() noexcept
+    {
+        const int inGuard = (writePosition - guardFrames) >> 31;
+        return getFrames<Sample>() + (size + guardFrames + (inGuard & (writePosition - guardFrames))) * frameStride;
+    }
+
+    /**
+        One frame of per-lane state for each stage of the filters in the feedback path, cleared with
+        the history. It is kept as doubles when the history is float64, and as floats otherwise.
+    */
+    template <typename Value>
+    Value* getFilterState(int stage) noexcept
+    {
+        jassert(isPositiveAndBelow(stage, numFilterStages));
+        jassert((format == Format::float64) == (std::is_same<Value, double>::value));
+        return reinterpret_cast<Value*>(filterState) + stage * frameStride;
+    }
+
+    /** Largest magnitude in the last numFrames frames written, found with vector min/max over the history. */
+    float getRecentPeak(int numFrames) const noexcept
+    {
+        numFrames = jmin(numFrames, size);
+
+        const int start = (writePosition - numFrames) & mask;
+        const int firstRun = jmin(numFrames, size - start);
+
+        return jmax(getPeak(start, firstRun), getPeak(0, numFrames - firstRun));
+    }
+
+    /** Mean square over every lane of the last numFrames frames written. */
+    float getRecentMeanSquare(int numFrames) const noexcept
+    {
+        numFrames = jmin(numFrames, size);
+
+        if (numFrames <= 0 || channels == 0)
+            return 0.0f;
+
+        const int start = (writePosition - numFrames) & mask;
+        const int firstRun = jmin(numFrames, size - start);
+
+        // Padding lanes hold zeros, so they add nothing to the sum and are left out of the count
+        return (float)((getSumOfSquares(start, firstRun) + getSumOfSquares(0, numFrames - firstRun)) / (double)(numFrames * channels));
+    }
+
+    /** Moves the write head on by one frame. */
+    void advance() noexcept
+    {
+        writePosition = (writePosition + 1) & mask;
+    }
+
+    //==============================================================================
+    /** Converts a frame to the compact format, written so the compiler vectorises it. Reads scale by compactHeadroom / 32767. */
+    template <typename Value>
+    static void encode(const Value* source, int16* destination, int numSamples) noexcept
+    {
+        constexpr Value scale = (Value)32767 / (Value)compactHeadroom;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const Value scaled = jlimit((Value)-32767, (Value)32767, source[i] * scale);
+            destination[i] = (int16)(scaled + (scaled < (Value)0 ? (Value)-0.5 : (Value)0.5));
+        }
+    }
+
+private:
+    HeapBlock<char>     storage;
+    char*               frames = nullptr;
+    HeapBlock<char>     filterStorage;
+    char*               filterState = nullptr;
+    Format              format = Format::float32;
+    int                 channels = 0, frameStride = 0;
+    int                 size = 0, mask = 0, writePosition = 0;
+
+    static size_t getSampleBytes(Format f) noexcept
+    {
+        return f == Format::int16 ? sizeof(int16) : (f == Format::float64 ? sizeof(double) : sizeof(float));
+    }
+
+    size_t getFilterStateBytes() const noexcept
+    {
+        return (size_t)(numFilterStages * frameStride) * (format == Format::float64 ? sizeof(double) : sizeof(float));
+    }
+
+    static char* align(char* data) noexcept
+    {
+        return reinterpret_cast<char*>(((pointer_sized_int)data + (pointer_sized_int)alignment - 1) & ~(pointer_sized_int)(alignment - 1));
+    }
+
+    float getPeak(int firstFrame, int numFrames) const noexcept
+    {
+        if (numFrames <= 0)
+            return 0.0f;
+
+        const int numSamples = numFrames * frameStride;
+
+        if (format == Format::int16)
+        {
+            const int16* samples = getFrames<int16>() + firstFrame * frameStride;
+            int peak = 0;
+
+            for (int i = 0; i < numSamples; ++i)
+                peak = jmax(peak, std::abs((int)samples[i]));
+
+            return (float)peak * (compactHeadroom / 32767.0f);
+        }
+
+        if (format == Format::float64)
+        {
+            const auto range = FloatVectorOperations::findMinAndMax(getFrames<double>() + firstFrame * frameStride, numSamples);
+            return (float)jmax(-range.getStart(), range.getEnd());
+        }
+
+        const auto range = FloatVectorOperations::findMinAndMax(getFrames<float>() + firstFrame * frameStride, numSamples);
+        return jmax(-range.getStart(), range.getEnd());
+    }
+
+    double getSumOfSquares(int firstFrame, int numFrames) const noexcept
+    {
+        if (numFrames <= 0)
+            return 0.0;
+
+        const int numSamples = numFrames * frameStride;
+
+        if (format == Format::int16)
+        {
+            const int16* samples = getFrames<int16>() + firstFrame * frameStride;
+            int64 sum = 0;
+
+            for (int i = 0; i < numSamples; ++i)
+                sum += (int)samples[i] * (int)samples[i];
+
+            return (double)sum * square(compactHeadroom / 32767.0);
+        }
+
+        if (format == Format::float64)
+            return sumOfSquares(getFrames<double>() + firstFrame * frameStride, numSamples);
+
+        return sumOfSquares(getFrames<float>() + firstFrame * frameStride, numSamples);
+    }
+
+    template <typename Sample>
+    static double sumOfSquares(const Sample* samples, int numSamples) noexcept
+    {
+        Sample sums[8] {};
+        int i = 0;
+
+        for (; i + 8 <= numSamples; i += 8)
+            for (int k = 0; k < 8; ++k)
+                sums[k] += samples[i + k] * samples[i + k];
+
+        double sum = 0.0;
+
+        for (; i < numSamples; ++i)
+            sum += (double)(samples[i] * samples[i]);
+
+        for (auto partial : sums)
+            sum += (double)partial;
+
+        return sum;
+    }
+
+    template <typename Sample>
+    Sample* getFrames() const noexcept
+    {
+        jassert(getSampleBytes(format) == sizeof(Sample));
+        return reinterpret_cast<Sample*>(frames);
+    }
+
+    JUCE_LEAK_DETECTOR (DelayLine)
+};
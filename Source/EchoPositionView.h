@@ -0,0 +1,204 @@
+/*
+  ==============================================================================
+
+    EchoPositionView.h
+    Top and side views of the speakers, with the echoes placed where they are
+    heard from.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "LevelMeter.h"
+#include "StaticLayer.h"
+
+using namespace juce;
+
+//==============================================================================
+/**
+    Draws the speaker layout seen from above and from the left, and a dot for
+    each echo of the current routing, sized by its gain and lit by the level
+    of the delay history. A ring leaves each dot once per repeat of its delay.
+
+    The circles and speakers are drawn once into an image, when the layout or
+    the size changes; a frame only blits that and draws the dots. Dots glide
+    to new positions instead of jumping, and frames are skipped whenever the
+    last one took longer than frameBudgetMs, so an expensive renderer costs a
+    lower frame rate rather than more time on the message thread. Nothing is
+    repainted while the delay is silent and the dots have settled.
+*/
+class EchoPositionView : public Component
+{
+public:
+    static constexpr double frameBudgetMs = 1.0;        // A sixteenth of a 60 Hz frame
+    static constexpr float glide = 0.3f;                // Share of the way to a new position covered each frame
+    static constexpr float silentLevel = 1.0e-4f;       // -80 dBFS of history
+
+    EchoPositionView()
+    {
+        setOpaque(true);
+        setInterceptsMouseClicks(false, false);
+    }
+
+    /** The speakers to draw; the message thread builds this from the processor's buses. */
+    void setSpeakerLayout(const SpeakerLayout& newLayout)
+    {
+        layout = newLayout;
+        background.render(*this, [this] (Graphics& g) { drawBackground(g); });
+        repaint();
+    }
+
+    /** Message thread, once per editor frame. isNew is false when the processor has not published since the last one. */
+    void update(const MeterSnapshot& snapshot, bool isNew)
+    {
+        if (isNew)
+        {
+            numEchoes = snapshot.numEchoes;
+            historyLevel = snapshot.historyPeak;
+
+            for (int i = 0; i < numEchoes; ++i)
+                targets[i] = snapshot.echoes[i];
+        }
+
+        bool moving = false;
+
+        for (int i = 0; i < numEchoes; ++i)
+        {
+            auto& echo = echoes[i];
+            const auto& target = targets[i];
+
+            echo.x += glide * (target.x - echo.x);
+            echo.y += glide * (target.y - echo.y);
+            echo.z += glide * (target.z - echo.z);
+            echo.gain += glide * (target.gain - echo.gain);
+            echo.seconds = target.seconds;
+
+            moving |= std::abs(target.x - echo.x) + std::abs(target.y - echo.y) + std::abs(target.z - echo.z) > 1.0e-3f;
+        }
+
+        // Rings move every frame while there is something to hear
+        if (! moving && historyLevel < silentLevel && ! wasAudible)
+            return;
+
+        wasAudible = historyLevel >= silentLevel;
+
+        if (framesToSkip > 0)
+        {
+            --framesToSkip;
+            return;
+        }
+
+        repaint();
+    }
+
+    //==============================================================================
+    void paint(Graphics& g) override
+    {
+        const double startMs = Time::getMillisecondCounterHiRes();
+
+        background.draw(g, *this);
+
+        // Dots are as bright as the history is loud, from -60 dBFS up
+        const float brightness = jlimit(0.15f, 1.0f, 1.0f + Decibels::gainToDecibels(historyLevel, -60.0f) / 60.0f);
+        const double now = startMs * 0.001;
+
+        for (int i = 0; i < numEchoes; ++i)
+        {
+            const auto& echo = echoes[i];
+
+            if (echo.gain <= 0.0f)
+                continue;
+
+            const float radius = 2.0f + 4.0f * jmin(1.0f, echo.gain);
+            const float phase = echo.seconds > 0.0f ? (float)std::fmod(now, (double)echo.seconds) / echo.seconds : 0.0f;
+
+            for (auto centre : { toTop(echo.x, echo.y), toSide(echo.x, echo.z) })
+            {
+                g.setColour(Colours::orange.withAlpha(brightness));
+                g.fillEllipse(Rectangle<float>(radius * 2.0f, radius * 2.0f).withCentre(centre));
+
+                if (wasAudible)
+                {
+                    const float ring = radius + phase * 12.0f;
+                    g.setColour(Colours::orange.withAlpha(brightness * (1.0f - phase) * 0.6f));
+                    g.drawEllipse(Rectangle<float>(ring * 2.0f, ring * 2.0f).withCentre(centre), 1.0f);
+                }
+            }
+        }
+
+        // The next frames wait until this one's cost has been paid back out of the budget
+        const double elapsedMs = Time::getMillisecondCounterHiRes() - startMs;
+        framesToSkip = jmin(30, (int)(elapsedMs / frameBudgetMs));
+    }
+
+    void resized() override
+    {
+        // Two squares side by side, under a line for their titles
+        const auto bounds = getLocalBounds().toFloat().withTrimmedTop(14.0f).reduced(4.0f);
+        const float size = jmin(bounds.getHeight(), bounds.getWidth() * 0.5f);
+
+        topArea  = Rectangle<float>(size, size).withCentre({ bounds.getX() + bounds.getWidth() * 0.25f, bounds.getCentreY() });
+        sideArea = Rectangle<float>(size, size).withCentre({ bounds.getX() + bounds.getWidth() * 0.75f, bounds.getCentreY() });
+
+        background.render(*this, [this] (Graphics& g) { drawBackground(g); });
+    }
+
+private:
+    SpeakerLayout       layout;
+    StaticLayer         background;
+    Rectangle<float>    topArea, sideArea;
+
+    int                 numEchoes = 0;
+    MeterSnapshot::Echo echoes[MeterSnapshot::maxEchoes], targets[MeterSnapshot::maxEchoes];
+    float               historyLevel = 0.0f;
+    bool                wasAudible = false;
+    int                 framesToSkip = 0;
+
+    // Seen from above with the front at the top, and from the left with the front to the left
+    Point<float> toTop(float x, float y) const noexcept
+    {
+        return { topArea.getCentreX() - y * topArea.getWidth() * 0.45f, topArea.getCentreY() - x * topArea.getHeight() * 0.45f };
+    }
+
+    Point<float> toSide(float x, float z) const noexcept
+    {
+        return { sideArea.getCentreX() - x * sideArea.getWidth() * 0.45f, sideArea.getCentreY() - z * sideArea.getHeight() * 0.45f };
+    }
+
+    void drawBackground(Graphics& g)
+    {
+        g.fillAll(Colour(0xff101418));
+
+        g.setColour(Colours::white);
+        g.setFont(14.0f);
+        g.drawText("Top",  topArea.withY(0.0f).withHeight(14.0f), Justification::centred, false);
+        g.drawText("Side", sideArea.withY(0.0f).withHeight(14.0f), Justification::centred, false);
+
+        g.setColour(Colours::ghostwhite.withAlpha(0.3f));
+        g.drawEllipse(topArea.reduced(topArea.getWidth() * 0.05f), 1.0f);
+        g.drawEllipse(sideArea.reduced(sideArea.getWidth() * 0.05f), 1.0f);
+        g.drawHorizontalLine(roundToInt(sideArea.getCentreY()), sideArea.getX(), sideArea.getRight());
+
+        // Listener, then the speakers; LFE and the like have no position
+        g.setColour(Colours::ghostwhite);
+        g.fillEllipse(Rectangle<float>(6.0f, 6.0f).withCentre(topArea.getCentre()));
+        g.fillEllipse(Rectangle<float>(6.0f, 6.0f).withCentre(sideArea.getCentre()));
+
+        g.setColour(Colours::skyblue);
+
+        for (int channel = 0; channel < layout.numChannels; ++channel)
+        {
+            const auto& speaker = layout.speakers[channel];
+
+            if (speaker.lane < 0)
+                continue;
+
+            g.fillRect(Rectangle<float>(6.0f, 6.0f).withCentre(toTop(speaker.x, speaker.y)));
+            g.fillRect(Rectangle<float>(6.0f, 6.0f).withCentre(toSide(speaker.x, speaker.z)));
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (EchoPositionView)
+};
@@ -0,0 +1,149 @@
+/*
+  ==============================================================================
+
+    Interpolation.h
+    Fractional-delay interpolators the delay taps can read with.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+using namespace juce;
+
+//==============================================================================
+/**
+    Turns a tap's fractional position into FIR weights over numPoints
+    consecutive history frames. Because a tap's delay only changes between
+    blocks, the weights are worked out once per tap per block and the kernel
+    just runs a short dot product per sample.
+
+    The tiers, from cheapest to cleanest:
+        linear      2 points, the original behaviour; rolls off the top octave
+        hermite     4 point Catmull-Rom cubic
+        lagrange    4 point, third order
+        sinc        8 point Kaiser-windowed sinc, read from a polyphase table
+
+    Points are laid out oldest first, and the interpolated position falls
+    fraction of the way between points numPoints / 2 - 1 and numPoints / 2.
+*/
+class Interpolator
+{
+public:
+    enum Type
+    {
+        linear,
+        hermite,
+        lagrange,
+        sinc
+    };
+
+    static constexpr int maxPoints = 8;
+    static constexpr int numPhases = 512;
+
+    /** Builds the sinc table. Allocates nothing, but is too slow for the audio thread. */
+    void prepare()
+    {
+        if (sincReady)
+            return;
+
+        constexpr double beta = 7.0;
+        const double windowScale = 1.0 / besselI0(beta);
+
+        for (int phase = 0; phase <= numPhases; ++phase)
+        {
+            const double fraction = (double)phase / numPhases;
+            double sum = 0.0;
+
+            for (int point = 0; point < maxPoints; ++point)
+            {
+                const double x = (double)(point - (maxPoints / 2 - 1)) - fraction;
+                const double edge = x / (maxPoints / 2);
+                const double window = std::abs(edge) < 1.0 ? besselI0(beta * std::sqrt(1.0 - edge * edge)) * windowScale : 0.0;
+                const double value = (x == 0.0 ? 1.0 : std::sin(MathConstants<double>::pi * x) / (MathConstants<double>::pi * x)) * window;
+
+                sincTable[phase][point] = (float)value;
+                sum += value;
+            }
+
+            // Unity gain at DC, so a held signal does not ripple as the fraction moves
+            for (int point = 0; point < maxPoints; ++point)
+                sincTable[phase][point] = (float)(sincTable[phase][point] / sum);
+        }
+
+        sincReady = true;
+    }
+
+    void setType(Type newType) noexcept         { type = newType; }
+    Type getType() const noexcept               { return type; }
+    int getNumPoints() const noexcept           { return getNumPoints(type); }
+
+    static int getNumPoints(Type t) noexcept
+    {
+        return t == linear ? 2 : (t == sinc ? maxPoints : 4);
+    }
+
+    /** Writes getNumPoints() weights for a position fraction (0 to 1) past the middle point. */
+    void getWeights(float fraction, float* weights) const noexcept
+    {
+        const float t = fraction;
+
+        switch (type)
+        {
+            case hermite:
+                weights[0] = 0.5f * t * ((2.0f - t) * t - 1.0f);
+                weights[1] = 0.5f * (t * t * (3.0f * t - 5.0f) + 2.0f);
+                weights[2] = 0.5f * t * ((4.0f - 3.0f * t) * t + 1.0f);
+                weights[3] = 0.5f * t * t * (t - 1.0f);
+                break;
+
+            case lagrange:
+                weights[0] = -t * (t - 1.0f) * (t - 2.0f) * (1.0f / 6.0f);
+                weights[1] = (t + 1.0f) * (t - 1.0f) * (t - 2.0f) * 0.5f;
+                weights[2] = -(t + 1.0f) * t * (t - 2.0f) * 0.5f;
+                weights[3] = (t + 1.0f) * t * (t - 1.0f) * (1.0f / 6.0f);
+                break;
+
+            case sinc:
+            {
+                jassert(sincReady);
+
+                // Linear blend of the two nearest phases
+                const float position = t * (float)numPhases;
+                const int phase = jmin((int)position, numPhases - 1);
+                const float blend = position - (float)phase;
+
+                for (int point = 0; point < maxPoints; ++point)
+                    weights[point] = sincTable[phase][point] + (sincTable[phase + 1][point] - sincTable[phase][point]) * blend;
+
+                break;
+            }
+
+            case linear:
+            default:
+                weights[0] = 1.0f - t;
+                weights[1] = t;
+                break;
+        }
+    }
+
+private:
+    Type    type = linear;
+    bool    sincReady = false;
+    float   sincTable[numPhases + 1][maxPoints] {};
+
+    static double besselI0(double x) noexcept
+    {
+        double sum = 1.0, term = 1.0;
+
+        for (int k = 1; k < 32; ++k)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+
+        return sum;
+    }
+};
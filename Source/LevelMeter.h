@@ -0,0 +1,249 @@
+/*
+  ==============================================================================
+
+    LevelMeter.h
+    Per-channel output levels, the delay history's level and where the echoes
+    are heard from, handed from the audio thread to the editor without locks.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DelayKernel.h"
+
+using namespace juce;
+
+//==============================================================================
+/** Levels over the samples since the last snapshot was published, all linear. */
+struct MeterSnapshot
+{
+    static constexpr int maxChannels = SpeakerLayout::maxChannels;
+    static constexpr int maxEchoes = DelayRouting::maxTaps;
+
+    /** One read head of the delay: its direction as the energy-weighted mean of the speakers it plays from. */
+    struct Echo
+    {
+        float   x = 0.0f, y = 0.0f, z = 0.0f;       // Inside the unit sphere: x front, y left, z up
+        float   gain = 0.0f;                        // Overall gain to the outputs
+        float   seconds = 0.0f;                     // Delay
+    };
+
+    int     numChannels = 0;
+    float   peak[maxChannels] {};
+    float   rms[maxChannels] {};
+    float   historyPeak = 0.0f;         // What the delay wrote into its history: how loud the tail still is
+    float   historyRms = 0.0f;
+    uint32  sequence = 0;               // Counts publishes, so a reader can tell a new snapshot from a repeat
+
+    int     numEchoes = 0;
+    Echo    echoes[maxEchoes];
+};
+
+//==============================================================================
+/**
+    The audio thread measures each block into its accumulators and publishes
+    them through a triple buffer: it fills its own slot and swaps it with the
+    middle one in a single atomic exchange, and the reader swaps the middle
+    with its slot the same way when a new one is there. Neither side waits
+    for the other, and the audio thread never touches the slot being read.
+
+    A snapshot is only published once the previous one has been read, so
+    peaks between two editor frames are held rather than overwritten. With no
+    reader, a snapshot is still published every maxWindowSeconds so the
+    accumulators never cover more than that.
+*/
+class LevelMeter
+{
+public:
+    static constexpr int maxChannels = MeterSnapshot::maxChannels;
+    static constexpr double maxWindowSeconds = 0.1;
+
+    LevelMeter() = default;
+
+    /** Message thread, while the audio thread is stopped. */
+    void prepare(double sampleRate) noexcept
+    {
+        maxWindow = jmax(1, (int)(sampleRate * maxWindowSeconds));
+        accumulated = {};
+        clearAccumulators();
+
+        for (auto& slot : slots)
+            slot = {};
+
+        writeSlot = 0;
+        readSlot = 1;
+        middle.store(2);
+    }
+
+    //==============================================================================
+    /** Audio thread: adds the first numChannels channels of a processed block, peak and sum of squares in one pass. */
+    template <typename FloatType>
+    void measure(const AudioBuffer<FloatType>& buffer, int numChannels) noexcept
+    {
+        numChannels = jmin(numChannels, buffer.getNumChannels(), (int)maxChannels);
+        const int numSamples = buffer.getNumSamples();
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            FloatType peak, sumOfSquares;
+            getPeakAndSumOfSquares(buffer.getReadPointer(channel), numSamples, peak, sumOfSquares);
+
+            accumulated.peak[channel] = jmax(accumulated.peak[channel], (float)peak);
+            sumsOfSquares[channel] += (double)sumOfSquares;
+        }
+
+        accumulated.numChannels = numChannels;
+        numSamplesAccumulated += numSamples;
+    }
+
+    /** Audio thread: adds the level of what the delay wrote over the same samples. */
+    void measureHistory(float peak, float meanSquare, int numSamples) noexcept
+    {
+        accumulated.historyPeak = jmax(accumulated.historyPeak, peak);
+        historySumOfSquares += (double)meanSquare * numSamples;
+    }
+
+    /** Audio thread: true if the next publish() will hand a snapshot over, so anything only it needs is worth working out. */
+    bool isReadyToPublish() const noexcept
+    {
+        return numSamplesAccumulated > 0
+            && ((middle.load(std::memory_order_relaxed) & freshBit) == 0 || numSamplesAccumulated >= maxWindow);
+    }
+
+    /** Audio thread: where each tap of the routing is heard from. Only the last call before a publish counts. */
+    void measureEchoes(const DelayRouting& routing, const SpeakerLayout& layout, double sampleRate) noexcept
+    {
+        const int numEchoes = jmin(routing.numTaps, (int)MeterSnapshot::maxEchoes);
+
+        for (int tap = 0; tap < numEchoes; ++tap)
+        {
+            auto& echo = accumulated.echoes[tap];
+            echo = {};
+            float energy = 0.0f;
+
+            for (int channel = 0; channel < layout.numChannels; ++channel)
+            {
+                const auto& speaker = layout.speakers[channel];
+
+                if (speaker.lane < 0)
+                    continue;
+
+                const float weight = square(routing.tapOutput[tap][speaker.lane] * routing.wet[speaker.lane]);
+                echo.x += weight * speaker.x;
+                echo.y += weight * speaker.y;
+                echo.z += weight * speaker.z;
+                energy += weight;
+            }
+
+            if (energy > 0.0f)
+            {
+                echo.x /= energy;
+                echo.y /= energy;
+                echo.z /= energy;
+            }
+
+            echo.gain = std::sqrt(energy);
+            echo.seconds = (float)(routing.tapDelay[tap] / sampleRate);
+        }
+
+        accumulated.numEchoes = numEchoes;
+    }
+
+    /** Audio thread, after measuring a block: hands the accumulated levels over if the reader is ready for them. */
+    void publish() noexcept
+    {
+        if (! isReadyToPublish())
+            return;
+
+        auto& slot = slots[writeSlot];
+        slot = accumulated;
+
+        const double scale = 1.0 / (double)numSamplesAccumulated;
+
+        for (int channel = 0; channel < accumulated.numChannels; ++channel)
+            slot.rms[channel] = (float)std::sqrt(sumsOfSquares[channel] * scale);
+
+        slot.historyRms = (float)std::sqrt(historySumOfSquares * scale);
+        slot.sequence = ++sequence;
+
+        writeSlot = middle.exchange(writeSlot | freshBit, std::memory_order_acq_rel) & indexMask;
+        clearAccumulators();
+    }
+
+    //==============================================================================
+    /** Reader thread: the latest snapshot. Returns false, leaving it as the last one read, if nothing new was published. */
+    bool read(MeterSnapshot& snapshot) noexcept
+    {
+        if ((middle.load(std::memory_order_relaxed) & freshBit) == 0)
+        {
+            snapshot = slots[readSlot];
+            return false;
+        }
+
+        readSlot = middle.exchange(readSlot, std::memory_order_acq_rel) & indexMask;
+        snapshot = slots[readSlot];
+        return true;
+    }
+
+private:
+    static constexpr int freshBit = 4, indexMask = 3;
+
+    MeterSnapshot       slots[3];
+    int                 writeSlot = 0;              // Audio thread only
+    int                 readSlot = 1;               // Reader only
+    std::atomic<int>    middle { 2 };               // Slot between them, with freshBit set until the reader takes it
+
+    MeterSnapshot       accumulated;
+    double              sumsOfSquares[maxChannels] {};
+    double              historySumOfSquares = 0.0;
+    int                 numSamplesAccumulated = 0, maxWindow = 4800;
+    uint32              sequence = 0;
+
+    void clearAccumulators() noexcept
+    {
+        std::fill(std::begin(accumulated.peak), std::end(accumulated.peak), 0.0f);
+        std::fill(std::begin(sumsOfSquares), std::end(sumsOfSquares), 0.0);
+        accumulated.historyPeak = 0.0f;
+        historySumOfSquares = 0.0;
+        numSamplesAccumulated = 0;
+    }
+
+    // Independent partial results in each of the unroll lanes, so the compiler can keep them in one vector register
+    template <typename FloatType>
+    static void getPeakAndSumOfSquares(const FloatType* samples, int numSamples, FloatType& peak, FloatType& sumOfSquares) noexcept
+    {
+        constexpr int unroll = 8;
+        FloatType peaks[unroll] {}, sums[unroll] {};
+        int i = 0;
+
+        for (; i + unroll <= numSamples; i += unroll)
+        {
+            for (int k = 0; k < unroll; ++k)
+            {
+                const FloatType x = samples[i + k];
+                const FloatType magnitude = std::abs(x);
+                peaks[k] = magnitude > peaks[k] ? magnitude : peaks[k];
+                sums[k] += x * x;
+            }
+        }
+
+        for (int k = 0; i < numSamples; ++i, ++k)
+        {
+            const FloatType x = samples[i];
+            peaks[k] = jmax(peaks[k], std::abs(x));
+            sums[k] += x * x;
+        }
+
+        peak = sumOfSquares = 0;
+
+        for (int k = 0; k < unroll; ++k)
+        {
+            peak = jmax(peak, peaks[k]);
+            sumOfSquares += sums[k];
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LevelMeter)
+};
@@ -0,0 +1,103 @@
+/*
+  ==============================================================================
+
+    LevelMeterComponent.h
+    Bar meters for every output channel and the delay history.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "LevelMeter.h"
+
+using namespace juce;
+
+//==============================================================================
+/**
+    Draws the levels of a MeterSnapshot: one bar per output channel, with its
+    RMS filled and its peak as a line, then a last bar for the delay history.
+    Bars fall back at releaseDbPerUpdate per update, so a short peak stays
+    visible, and only the component is repainted, only when a bar moved.
+*/
+class LevelMeterComponent : public Component
+{
+public:
+    static constexpr float minimumDb = -60.0f;
+    static constexpr float releaseDbPerUpdate = 0.4f;           // 24 dB/s at 60 updates a second
+
+    LevelMeterComponent()
+    {
+        setInterceptsMouseClicks(false, false);
+        std::fill(std::begin(peakDb), std::end(peakDb), minimumDb);
+        std::fill(std::begin(rmsDb), std::end(rmsDb), minimumDb);
+    }
+
+    /** Message thread, once per editor frame. */
+    void update(const MeterSnapshot& snapshot)
+    {
+        bool changed = snapshot.numChannels != numChannels;
+        numChannels = snapshot.numChannels;
+
+        for (int channel = 0; channel <= numChannels; ++channel)
+        {
+            const bool history = channel == numChannels;
+            changed |= follow(peakDb[channel], history ? snapshot.historyPeak : snapshot.peak[channel]);
+            changed |= follow(rmsDb[channel],  history ? snapshot.historyRms : snapshot.rms[channel]);
+        }
+
+        if (changed)
+            repaint();
+    }
+
+    void paint(Graphics& g) override
+    {
+        if (numChannels == 0)
+            return;
+
+        // The channel bars, a gap, then the history bar
+        const float barWidth = (float)getWidth() / (float)(numChannels + 2);
+        const auto height = (float)getHeight();
+
+        for (int channel = 0; channel <= numChannels; ++channel)
+        {
+            const bool history = channel == numChannels;
+            const Rectangle<float> bar(barWidth * (float)(channel + (history ? 1 : 0)) + 1.0f, 0.0f, barWidth - 2.0f, height);
+
+            g.setColour(Colours::black.withAlpha(0.5f));
+            g.fillRect(bar);
+
+            g.setColour(history ? Colours::skyblue : Colours::limegreen);
+            g.fillRect(bar.withTop(height * (1.0f - toProportion(rmsDb[channel]))));
+
+            g.setColour(peakDb[channel] > -0.1f ? Colours::red : Colours::white);
+            g.fillRect(bar.withTop(height * (1.0f - toProportion(peakDb[channel]))).withHeight(1.5f));
+        }
+    }
+
+private:
+    int     numChannels = 0;
+    float   peakDb[MeterSnapshot::maxChannels + 1];
+    float   rmsDb[MeterSnapshot::maxChannels + 1];
+
+    // Jumps up to a new level, or falls towards it; true if the bar moves
+    static bool follow(float& displayedDb, float level)
+    {
+        const float targetDb = Decibels::gainToDecibels(level, minimumDb);
+        const float newDb = jmax(targetDb, displayedDb - releaseDbPerUpdate, minimumDb);
+
+        if (newDb == displayedDb)
+            return false;
+
+        displayedDb = newDb;
+        return true;
+    }
+
+    static float toProportion(float db)
+    {
+        return jlimit(0.0f, 1.0f, (db - minimumDb) / -minimumDb);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LevelMeterComponent)
+};
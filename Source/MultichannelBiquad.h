@@ -0,0 +1,133 @@
+/*
+  ==============================================================================
+
+    MultichannelBiquad.h
+    Cascade of biquad stages run across channels with one channel per SIMD lane.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "SpeakerLayout.h"
+
+//==============================================================================
+/**
+    A fixed cascade of second-order sections shared by every channel, each
+    channel keeping its own state. Channels are taken a register's width at a
+    time, so one multiply-add works on several channels at once, and every
+    stage of the cascade is applied to a sample frame before moving on: the
+    buffer is read and written once however many stages there are.
+
+    Each section is transposed direct form II with coefficients normalised by
+    a0, which is the arithmetic dsp::IIR::Filter does per channel. The sample
+    type sets both the buffers taken and the precision of the arithmetic, so
+    double processing gets double coefficients and state.
+
+    Coefficients are shared, and the state of a group of channels is only
+    touched by the call that processes them, so calls on disjoint groups that
+    each start on a register boundary can run on different threads.
+*/
+template <typename SampleType>
+class MultichannelBiquad
+{
+public:
+    using Register = dsp::SIMDRegister<SampleType>;
+
+    static constexpr int maxChannels = SpeakerLayout::maxChannels;
+    static constexpr int numStages = 2;
+    static constexpr int lanes = (int)Register::size();
+
+    /** Every stage starts as a pass-through until given coefficients. */
+    MultichannelBiquad() noexcept
+    {
+        for (int stage = 0; stage < numStages; ++stage)
+            setCoefficients(stage, { 1, 0, 0, 1, 0, 0 });
+    }
+
+    void reset() noexcept
+    {
+        zeromem(state, sizeof(state));
+    }
+
+    /** Sets a stage from { b0, b1, b2, a0, a1, a2 }, as made by dsp::IIR::ArrayCoefficients. Does not allocate. */
+    void setCoefficients(int stage, const std::array<SampleType, 6>& c) noexcept
+    {
+        jassert(isPositiveAndBelow(stage, numStages) && c[3] != 0);
+
+        const SampleType a0 = 1 / c[3];
+        auto& section = coefficients[stage];
+
+        section.b0 = Register::expand(c[0] * a0);
+        section.b1 = Register::expand(c[1] * a0);
+        section.b2 = Register::expand(c[2] * a0);
+        section.a1 = Register::expand(c[4] * a0);
+        section.a2 = Register::expand(c[5] * a0);
+    }
+
+    /** Filters numChannels channels in place; channels[0] is channel firstChannel, which must start a register. */
+    void process(SampleType* const* channels, int firstChannel, int numChannels, int numSamples) noexcept
+    {
+        jassert(firstChannel % lanes == 0 && firstChannel + numChannels <= maxChannels);
+
+        for (int first = 0; first < numChannels; first += lanes)
+        {
+            const int active = jmin(lanes, numChannels - first);
+            const int group = (firstChannel + first) / lanes;
+
+            Register s1[numStages], s2[numStages];
+
+            for (int stage = 0; stage < numStages; ++stage)
+            {
+                s1[stage] = Register::fromRawArray(state[stage][0] + group * lanes);
+                s2[stage] = Register::fromRawArray(state[stage][1] + group * lanes);
+            }
+
+            alignas(Register::SIMDRegisterSize) SampleType frame[lanes] {};
+
+            for (int sample = 0; sample < numSamples; ++sample)
+            {
+                for (int lane = 0; lane < active; ++lane)
+                    frame[lane] = channels[first + lane][sample];
+
+                Register value = Register::fromRawArray(frame);
+
+                for (int stage = 0; stage < numStages; ++stage)
+                {
+                    const auto& section = coefficients[stage];
+                    const Register input = value;
+
+                    value = input * section.b0 + s1[stage];
+                    s1[stage] = input * section.b1 - value * section.a1 + s2[stage];
+                    s2[stage] = input * section.b2 - value * section.a2;
+                }
+
+                value.copyToRawArray(frame);
+
+                for (int lane = 0; lane < active; ++lane)
+                    channels[first + lane][sample] = frame[lane];
+            }
+
+            // Lanes past the last channel filter zeros and so keep a zero state
+            for (int stage = 0; stage < numStages; ++stage)
+            {
+                s1[stage].copyToRawArray(state[stage][0] + group * lanes);
+                s2[stage].copyToRawArray(state[stage][1] + group * lanes);
+            }
+        }
+    }
+
+private:
+    struct Section
+    {
+        Register b0, b1, b2, a1, a2;
+    };
+
+    static constexpr int paddedChannels = (maxChannels + lanes - 1) / lanes * lanes;
+
+    Section     coefficients[numStages];
+
+    alignas(Register::SIMDRegisterSize) SampleType state[numStages][2][paddedChannels] {};
+
+    JUCE_LEAK_DETECTOR (MultichannelBiquad)
+};
@@ -0,0 +1,119 @@
+/*
+  ==============================================================================
+
+    ParameterEventQueue.h
+    Timed parameter changes handed to the audio thread, applied on their sample.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+using namespace juce;
+
+//==============================================================================
+/** A normalised parameter value to apply sampleOffset samples into the next block. */
+struct ParameterChange
+{
+    int     parameterIndex = 0;
+    float   value = 0.0f;
+    int     sampleOffset = 0;
+};
+
+//==============================================================================
+/**
+    Parameter changes stamped with the sample they should land on, so the
+    processor can split its block at each one instead of reading every
+    parameter once per block.
+
+    One thread pushes and the audio thread collects, through an AbstractFifo,
+    so neither side locks or allocates. Offsets count from the start of the
+    next block the processor handles: pushed from the audio thread just before
+    processBlock, as a host wrapper with timed automation would, they are
+    sample-accurate. Changes due after the end of that block wait for the next.
+*/
+class ParameterEventQueue
+{
+public:
+    static constexpr int capacity = 256;
+
+    /** Producer side. Returns false, dropping the change, when the queue is full. */
+    bool push(const ParameterChange& change) noexcept
+    {
+        const auto scope = fifo.write(1);
+
+        if (scope.blockSize1 + scope.blockSize2 == 0)
+            return false;
+
+        incoming[scope.blockSize1 > 0 ? scope.startIndex1 : scope.startIndex2] = change;
+        return true;
+    }
+
+    /** Audio thread: moves everything pushed so far into the pending list, ordered by offset. */
+    void collect() noexcept
+    {
+        const auto scope = fifo.read(fifo.getNumReady());
+        scope.forEach([this] (int index) { insert(incoming[index]); });
+    }
+
+    /** Offset of the first pending change, or INT_MAX when there is none. */
+    int getNextOffset() const noexcept
+    {
+        return numPending > 0 ? pending[0].sampleOffset : std::numeric_limits<int>::max();
+    }
+
+    /** Hands every pending change due at or before offset to apply, in order, and drops it. */
+    template <typename Callback>
+    void popDue(int offset, Callback&& apply) noexcept
+    {
+        int count = 0;
+
+        while (count < numPending && pending[count].sampleOffset <= offset)
+            apply(pending[count++]);
+
+        std::copy(pending + count, pending + numPending, pending);
+        numPending -= count;
+    }
+
+    /** Moves the changes still pending on past a finished block. */
+    void advance(int numSamples) noexcept
+    {
+        for (int i = 0; i < numPending; ++i)
+            pending[i].sampleOffset -= numSamples;
+    }
+
+    /** Drops everything. Not safe while another thread is pushing. */
+    void clear() noexcept
+    {
+        fifo.reset();
+        numPending = 0;
+    }
+
+private:
+    AbstractFifo        fifo { capacity };
+    ParameterChange     incoming[capacity];
+    ParameterChange     pending[capacity];
+    int                 numPending = 0;
+
+    // Insertion keeps changes on the same sample in the order they were pushed
+    void insert(ParameterChange change) noexcept
+    {
+        jassert(numPending < capacity);     // Changes are being queued faster than blocks use them
+
+        if (numPending >= capacity)
+            return;
+
+        change.sampleOffset = jmax(0, change.sampleOffset);
+
+        int position = numPending++;
+
+        for (; position > 0 && pending[position - 1].sampleOffset > change.sampleOffset; --position)
+            pending[position] = pending[position - 1];
+
+        pending[position] = change;
+    }
+
+    JUCE_LEAK_DETECTOR (ParameterEventQueue)
+};
@@ -0,0 +1,328 @@
+/*
+  ==============================================================================
+
+    ParameterSnapshot.h
+    Typed, per-block copy of the plugin parameters for the audio thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+using namespace juce;
+
+//==============================================================================
+/**
+    Plain copy of every parameter, taken once per block. Each field has a flag
+    that is set when its value moves, and stays set until clearChanges(), so
+    derived state (delay routing, filter targets) is only rebuilt when needed.
+*/
+struct ParameterSnapshot
+{
+    enum Flags : uint32
+    {
+        inputGainChanged     = 1 << 0,
+        delayTimeChanged     = 1 << 1,
+        mixChanged           = 1 << 2,
+        feedbackChanged      = 1 << 3,
+        balanceChanged       = 1 << 4,
+        offsetChanged        = 1 << 5,
+        lowpassChanged       = 1 << 6,
+        highpassChanged      = 1 << 7,
+        outputGainChanged    = 1 << 8,
+        delayOptionChanged   = 1 << 9,
+        interpolationChanged = 1 << 10,
+        dampLowpassChanged   = 1 << 11,
+        dampHighpassChanged  = 1 << 12,
+        delayNetworkChanged  = 1 << 13,
+
+        allChanged           = (1 << 14) - 1,
+        delayRoutingChanged  = delayTimeChanged | mixChanged | feedbackChanged | balanceChanged | offsetChanged | delayOptionChanged
+                             | delayNetworkChanged
+    };
+
+    float   inputGain = 1.0f, delayTime = 2.0f, mix = 0.5f, feedback = 0.5f, balance = 0.5f, offset = 0.0f;
+    float   lowpass = 5000.0f, highpass = 5000.0f, outputGain = 1.0f;
+    float   dampLowpass = 20000.0f, dampHighpass = 20.0f;
+    int     delayOption = 1;
+    int     interpolation = 0;
+    int     delayNetwork = 0;
+
+    uint32  changed = allChanged;
+
+    bool hasChanged(uint32 flags) const noexcept    { return (changed & flags) != 0; }
+    void markAllChanged() noexcept                  { changed = allChanged; }
+    void clearChanges() noexcept                    { changed = 0; }
+
+    //==============================================================================
+    /**
+        The delay mode the processor runs: Ping-Pong, Normal, MidSide, Multi-Tap
+        or FDN. delay_option keeps the three choices it was released with, so
+        automation and sessions written against its normalised range still
+        land on the same mode; Multi-Tap and FDN are picked by delay_network,
+        which overrides delay_option unless it is Off.
+    */
+    static constexpr int numDelayOptions = 3;
+
+    static int getDelayMode(int option, int network) noexcept   { return network > 0 ? numDelayOptions - 1 + network : option; }
+    int getDelayMode() const noexcept                           { return getDelayMode(delayOption, delayNetwork); }
+
+    /** Sets both parameters for a mode; the later modes put delay_option back to its default. */
+    void setDelayMode(int mode) noexcept
+    {
+        setValue(delayOptionIndex, (float)(mode < numDelayOptions ? mode : 1));
+        setValue(delayNetworkIndex, (float)(mode < numDelayOptions ? 0 : mode - numDelayOptions + 1));
+    }
+
+    //==============================================================================
+    /** Parameter IDs in the order of the change flags, for code that walks every parameter: presets and saved state. */
+    static constexpr int numParameters = 14;
+    static inline const char* const parameterIDs[numParameters] = { "inGain", "delayTime", "mix", "feedback", "balance", "offset",
+                                                                     "lowpass", "highpass", "outGain", "delay_option", "interpolation",
+                                                                     "dampLowpass", "dampHighpass", "delay_network" };
+
+    static constexpr int delayOptionIndex = 9, interpolationIndex = 10, delayNetworkIndex = 13;
+
+    /** A field by parameter index, as the float the parameter tree holds; choices are their index. */
+    float getValue(int index) const noexcept
+    {
+        switch (index)
+        {
+            case 0:     return inputGain;
+            case 1:     return delayTime;
+            case 2:     return mix;
+            case 3:     return feedback;
+            case 4:     return balance;
+            case 5:     return offset;
+            case 6:     return lowpass;
+            case 7:     return highpass;
+            case 8:     return outputGain;
+            case 9:     return (float)delayOption;
+            case 10:    return (float)interpolation;
+            case 11:    return dampLowpass;
+            case 12:    return dampHighpass;
+            case 13:    return (float)delayNetwork;
+            default:    jassertfalse; return 0.0f;
+        }
+    }
+
+    void setValue(int index, float value) noexcept
+    {
+        switch (index)
+        {
+            case 0:     inputGain = value; break;
+            case 1:     delayTime = value; break;
+            case 2:     mix = value; break;
+            case 3:     feedback = value; break;
+            case 4:     balance = value; break;
+            case 5:     offset = value; break;
+            case 6:     lowpass = value; break;
+            case 7:     highpass = value; break;
+            case 8:     outputGain = value; break;
+            case 9:     delayOption = roundToInt(value); break;
+            case 10:    interpolation = roundToInt(value); break;
+            case 11:    dampLowpass = value; break;
+            case 12:    dampHighpass = value; break;
+            case 13:    delayNetwork = roundToInt(value); break;
+            default:    jassertfalse; break;
+        }
+
+        changed |= 1u << index;
+    }
+};
+
+//==============================================================================
+/**
+    Looks the parameter atomics up by ID once, at construction, so refreshing
+    a ParameterSnapshot on the audio thread costs one relaxed load per
+    parameter with no string hashing and no juce::Value objects.
+
+    It also maps host parameter indices to those atomics, so a change queued
+    for a sample inside the block can be applied on the audio thread. Such a
+    change goes straight into the snapshot, and refresh() keeps it there
+    until the message thread has passed it on to the parameter through
+    notifyApplied(), at which point the raw value catches up. The audio
+    thread never calls listeners, which lock, and the message thread never
+    waits for the audio thread.
+*/
+class ParameterCache
+{
+public:
+    explicit ParameterCache(const AudioProcessorValueTreeState& parameters)
+    {
+        add(parameters, "inGain",       &ParameterSnapshot::inputGain,  ParameterSnapshot::inputGainChanged);
+        add(parameters, "delayTime",    &ParameterSnapshot::delayTime,  ParameterSnapshot::delayTimeChanged);
+        add(parameters, "mix",          &ParameterSnapshot::mix,        ParameterSnapshot::mixChanged);
+        add(parameters, "feedback",     &ParameterSnapshot::feedback,   ParameterSnapshot::feedbackChanged);
+        add(parameters, "balance",      &ParameterSnapshot::balance,    ParameterSnapshot::balanceChanged);
+        add(parameters, "offset",       &ParameterSnapshot::offset,     ParameterSnapshot::offsetChanged);
+        add(parameters, "lowpass",      &ParameterSnapshot::lowpass,    ParameterSnapshot::lowpassChanged);
+        add(parameters, "highpass",     &ParameterSnapshot::highpass,   ParameterSnapshot::highpassChanged);
+        add(parameters, "outGain",      &ParameterSnapshot::outputGain, ParameterSnapshot::outputGainChanged);
+        add(parameters, "dampLowpass",  &ParameterSnapshot::dampLowpass, ParameterSnapshot::dampLowpassChanged);
+        add(parameters, "dampHighpass", &ParameterSnapshot::dampHighpass, ParameterSnapshot::dampHighpassChanged);
+
+        delayOption = parameters.getRawParameterValue("delay_option");
+        interpolation = parameters.getRawParameterValue("interpolation");
+        delayNetwork = parameters.getRawParameterValue("delay_network");
+        jassert(delayOption != nullptr && interpolation != nullptr && delayNetwork != nullptr);
+
+        for (int index = 0; index < ParameterSnapshot::numParameters; ++index)
+        {
+            auto* parameter = parameters.getParameter(ParameterSnapshot::parameterIDs[index]);
+            jassert(parameter != nullptr && isPositiveAndBelow(parameter->getParameterIndex(), ParameterSnapshot::numParameters));
+
+            hostParameters[parameter->getParameterIndex()] = { parameter, index };
+        }
+    }
+
+    /** Copies the current values into the snapshot and flags the ones that moved. */
+    void refresh(ParameterSnapshot& snapshot) const noexcept
+    {
+        for (int i = 0; i < numEntries; ++i)
+        {
+            const Entry& entry = entries[i];
+
+            if (isHeld(entry.index))
+                continue;
+
+            const float value = entry.source->load(std::memory_order_relaxed);
+            float& field = snapshot.*(entry.field);
+
+            if (value != field)
+            {
+                field = value;
+                snapshot.changed |= entry.flag;
+            }
+        }
+
+        const int option = roundToInt(delayOption->load(std::memory_order_relaxed));
+
+        if (option != snapshot.delayOption && ! isHeld(ParameterSnapshot::delayOptionIndex))
+        {
+            snapshot.delayOption = option;
+            snapshot.changed |= ParameterSnapshot::delayOptionChanged;
+        }
+
+        const int network = roundToInt(delayNetwork->load(std::memory_order_relaxed));
+
+        if (network != snapshot.delayNetwork && ! isHeld(ParameterSnapshot::delayNetworkIndex))
+        {
+            snapshot.delayNetwork = network;
+            snapshot.changed |= ParameterSnapshot::delayNetworkChanged;
+        }
+
+        const int tier = roundToInt(interpolation->load(std::memory_order_relaxed));
+
+        if (tier != snapshot.interpolation && ! isHeld(ParameterSnapshot::interpolationIndex))
+        {
+            snapshot.interpolation = tier;
+            snapshot.changed |= ParameterSnapshot::interpolationChanged;
+        }
+    }
+
+    /** Audio thread: puts a normalised value for the parameter at a host index into the snapshot, and posts it for notifyApplied(). */
+    void apply(ParameterSnapshot& snapshot, int parameterIndex, float normalisedValue) noexcept
+    {
+        if (! isPositiveAndBelow(parameterIndex, ParameterSnapshot::numParameters))
+            return;
+
+        const auto& target = hostParameters[parameterIndex];
+
+        if (target.parameter == nullptr)
+            return;
+
+        const float value = target.parameter->convertFrom0to1(normalisedValue);
+
+        if (value != snapshot.getValue(target.snapshotIndex))
+            snapshot.setValue(target.snapshotIndex, value);
+
+        auto& posted = postedChanges[target.snapshotIndex];
+        posted.value.store(normalisedValue, std::memory_order_relaxed);
+        posted.generation.store(posted.generation.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /**
+        Message thread, from a timer: sets each parameter apply() changed to the
+        last value it was given, notifying the host, the tree and the editor.
+        If the host moves a parameter while a change to it waits here, the
+        queued value still wins.
+    */
+    void notifyApplied()
+    {
+        for (auto& target : hostParameters)
+        {
+            if (target.parameter == nullptr)
+                continue;
+
+            auto& posted = postedChanges[target.snapshotIndex];
+            const uint32 generation = posted.generation.load(std::memory_order_acquire);
+
+            if (generation == posted.notified.load(std::memory_order_relaxed))
+                continue;
+
+            // A newer value posted in between is read here and passed on again on the next call
+            target.parameter->setValueNotifyingHost(posted.value.load(std::memory_order_relaxed));
+            posted.notified.store(generation, std::memory_order_release);
+        }
+    }
+
+private:
+    struct HostParameter
+    {
+        RangedAudioParameter*       parameter = nullptr;
+        int                         snapshotIndex = 0;
+    };
+
+    /** A value apply() posted, and how far notifyApplied() has caught up with it. */
+    struct PostedChange
+    {
+        std::atomic<float>          value { 0.0f };
+        std::atomic<uint32>         generation { 0 }, notified { 0 };
+    };
+
+    struct Entry
+    {
+        std::atomic<float>*         source;
+        float ParameterSnapshot::*  field;
+        uint32                      flag;
+        int                         index;
+    };
+
+    static constexpr int maxEntries = 16;
+
+    Entry                   entries[maxEntries];
+    int                     numEntries = 0;
+    std::atomic<float>*     delayOption = nullptr;
+    std::atomic<float>*     interpolation = nullptr;
+    std::atomic<float>*     delayNetwork = nullptr;
+    HostParameter           hostParameters[ParameterSnapshot::numParameters];
+    PostedChange            postedChanges[ParameterSnapshot::numParameters];
+
+    // The snapshot keeps a posted value until the raw value has been set from it
+    bool isHeld(int index) const noexcept
+    {
+        const auto& posted = postedChanges[index];
+        return posted.notified.load(std::memory_order_acquire) != posted.generation.load(std::memory_order_relaxed);
+    }
+
+    void add(const AudioProcessorValueTreeState& parameters, const String& parameterID, float ParameterSnapshot::* field, uint32 flag)
+    {
+        jassert(numEntries < maxEntries);
+
+        auto* source = parameters.getRawParameterValue(parameterID);
+        jassert(source != nullptr);
+
+        // The flags are in parameter order, so each one's bit is its index
+        int index = 0;
+
+        while ((flag >> index) > 1)
+            ++index;
+
+        entries[numEntries++] = { source, field, flag, index };
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (ParameterCache)
+};
@@ -20,7 +20,9 @@ Atmos3DDelayAudioProcessorEditor::Atmos3DDelayAudioProcessorEditor(Atmos3DDelayA
     // editor's size to whatever you need it to be.
     buildElements();
 
-    setSize(1000, 500);
+    // Only the cached layer is painted by the editor itself, and it covers everything
+    setOpaque(true);
+    setSize(1000, 640);
 
     startTimerHz(60);
 }
@@ -33,18 +35,28 @@ Atmos3DDelayAudioProcessorEditor::~Atmos3DDelayAudioProcessorEditor()
 //==============================================================================
 void Atmos3DDelayAudioProcessorEditor::paint (juce::Graphics& g)
 {
+    // Everything here is static, so a repaint is one blit; the controls, meters and echo view repaint themselves
+    staticLayer.draw(g, *this);
+}
+
+void Atmos3DDelayAudioProcessorEditor::drawStaticLayer(Graphics& g)
+{
+    g.fillAll(Colour(0xff101418));
+
     Image background = ImageCache::getFromMemory(BinaryData::background_png, BinaryData::background_pngSize);
     g.drawImageAt(background, 0, 0);
     
-    //Draw the semi-transparent rectangle around components
-    const Rectangle<float> area(10, 20, 960, 460);
-    g.setColour(Colours::ghostwhite);
-    g.drawRoundedRectangle(area, 5.0f, 3.0f);
+    //Draw the semi-transparent rectangle around components, and around the echo view
+    for (auto area : { Rectangle<float>(10, 20, 960, 460), Rectangle<float>(10, 490, 960, 140) })
+    {
+        g.setColour(Colours::ghostwhite);
+        g.drawRoundedRectangle(area, 5.0f, 3.0f);
 
-    //Draw background for rectangle
-    g.setColour(Colours::black);
-    g.setOpacity(0.5f);
-    g.fillRoundedRectangle(area, 5.0f);
+        //Draw background for rectangle
+        g.setColour(Colours::black);
+        g.setOpacity(0.5f);
+        g.fillRoundedRectangle(area, 5.0f);
+    }
 
     //Draw text labels for each component
     g.setColour(Colours::white);
@@ -58,6 +70,9 @@ void Atmos3DDelayAudioProcessorEditor::paint (juce::Graphics& g)
     g.drawText("Feedback",          260, 435,    200, 50, Justification::centred, false);
     g.drawText("Mix",               390, 435,    200, 50, Justification::centred, false);
 
+    //// Damping of the repeats
+    g.drawText("Damping",           460, 25,     110, 30, Justification::centred, false);
+
     //// Low Pass
     g.drawText("High Cut",          720, 430,    200, 50, Justification::centred, false);
     g.drawText("LOW PASS FILTER",   720, 265, 200, 50, Justification::centred, false);
@@ -70,42 +85,35 @@ void Atmos3DDelayAudioProcessorEditor::paint (juce::Graphics& g)
     //// Output Gain
     g.drawText("Output Gain",       550, 430, 200, 50, Justification::centred, false);
 
-
-    if (delayOptions.getSelectedId() == 1)
-    {
-        balanceSlider.setVisible(true);
-        offsetKnob.setVisible(true);
-
-        balanceText.setVisible(true);
-        offsetText.setVisible(true);
-    }
-    else if (delayOptions.getSelectedId() == 2)
-    {
-        balanceSlider.setVisible(false);
-        offsetKnob.setVisible(false);
-
-        balanceText.setVisible(false);
-        offsetText.setVisible(false);
-    }
-    else if (delayOptions.getSelectedId() == 3)
-    {
-        balanceSlider.setVisible(false);
-        offsetKnob.setVisible(true);
-
-        balanceText.setVisible(false);
-        offsetText.setVisible(true);
-    }
+    //// Echo positions
+    g.drawText("ECHOES",            30, 540, 150, 40, Justification::centred, false);
 
     // Title of PlugIn
     g.setFont(35.0f);
     g.drawText("Atmos 3D-Delay", 125, 20, 1160, 75, Justification::centred, false);
 }
 
+void Atmos3DDelayAudioProcessorEditor::updateModeControls()
+{
+    // Balance belongs to Ping-Pong, Offset to Ping-Pong and MidSide; neither to the networks, which override them
+    const int mode = networkOptions.getSelectedId() > 1 ? 0 : delayOptions.getSelectedId();
+
+    balanceSlider.setVisible(mode == 1);
+    balanceText.setVisible(mode == 1);
+
+    offsetKnob.setVisible(mode == 1 || mode == 3);
+    offsetText.setVisible(mode == 1 || mode == 3);
+}
+
 void Atmos3DDelayAudioProcessorEditor::resized()
 {
+    staticLayer.render(*this, [this] (Graphics& g) { drawStaticLayer(g); });
+
     // This is generally where you'll want to lay out the positions of any subcomponents in your editor.
     // List of Options
     delayOptions.setBounds      (50, 50, 400, 50);
+    interpolationOptions.setBounds(50, 105, 200, 30);
+    networkOptions.setBounds    (260, 105, 190, 30);
 
     // Input Gain Slider
     inputGainSlider.setBounds   (15,    160,    150, 275);
@@ -121,17 +129,50 @@ void Atmos3DDelayAudioProcessorEditor::resized()
     lowCutSlider.setBounds      (750,  100, 140, 140);
     highCutSlider.setBounds     (750, 300, 140, 140);
 
+    // Damping bars, high cut above low cut
+    dampHighCutSlider.setBounds (460, 55, 110, 24);
+    dampLowCutSlider.setBounds  (460, 85, 110, 24);
+
     // Output Gain Slider
     outputGainSlider.setBounds  (580, 160, 150, 275);
 
     // Labels for Balance and Offset
     balanceText.setBounds(160, 265, 200, 50);
     offsetText.setBounds(355, 265, 200, 50);
+
+    // Output and delay history meters, down the right-hand edge
+    levelMeters.setBounds(905, 100, 55, 335);
+
+    // Top and side views of the speakers, in the strip below
+    echoView.setBounds(200, 495, 560, 130);
 }
 
 void Atmos3DDelayAudioProcessorEditor::timerCallback()
 {
+    // Only the meters and the echo view repaint, and only their own bounds
+    const bool isNew = audioProcessor.getLevelMeter().read(meterSnapshot);
+
+    if (isNew)
+        levelMeters.update(meterSnapshot);
 
+    // The speakers follow the buses themselves: layouts such as 7.1.2 and 5.1.4 have the same channel count
+    if (isNew)
+    {
+        const auto output = audioProcessor.getChannelLayoutOfBus(false, 0);
+        const auto input = audioProcessor.getBusCount(true) > 0 ? audioProcessor.getChannelLayoutOfBus(true, 0) : AudioChannelSet::stereo();
+
+        if ((output != shownOutput || input != shownInput) && SpeakerLayout::isSupported(output))
+        {
+            SpeakerLayout layout;
+            layout.build(output, input);
+            echoView.setSpeakerLayout(layout);
+
+            shownOutput = output;
+            shownInput = input;
+        }
+    }
+
+    echoView.update(meterSnapshot, isNew);
 }
 
 void Atmos3DDelayAudioProcessorEditor::buildElements()
@@ -142,8 +183,27 @@ void Atmos3DDelayAudioProcessorEditor::buildElements()
     delayOptions.addItem("Normal", 2);
     delayOptions.addItem("MidSide", 3);
     delayOptions.setSelectedId(1, dontSendNotification);
+    delayOptions.onChange = [this] { updateModeControls(); };
     addAndMakeVisible(&delayOptions);
 
+    // Multi-Tap and FDN replace the mode above while selected
+    networkOptions.setEditableText(false);
+    networkOptions.addItem("Off", 1);
+    networkOptions.addItem("Multi-Tap", 2);
+    networkOptions.addItem("FDN", 3);
+    networkVal = make_unique<AudioProcessorValueTreeState::ComboBoxAttachment>(audioProcessor.parameters, "delay_network", networkOptions);
+    networkOptions.onChange = [this] { updateModeControls(); };
+    addAndMakeVisible(&networkOptions);
+
+    // Items must exist before the attachment, so it can select the saved one
+    interpolationOptions.setEditableText(false);
+    interpolationOptions.addItem("Linear", 1);
+    interpolationOptions.addItem("Hermite", 2);
+    interpolationOptions.addItem("Lagrange", 3);
+    interpolationOptions.addItem("Sinc", 4);
+    interpolationVal = make_unique<AudioProcessorValueTreeState::ComboBoxAttachment>(audioProcessor.parameters, "interpolation", interpolationOptions);
+    addAndMakeVisible(&interpolationOptions);
+
     //Building the Input Gain
     inputGainVal = make_unique<AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.parameters, "inGain", inputGainSlider);
     inputGainSlider.setSliderStyle(Slider::SliderStyle::LinearVertical);
@@ -215,10 +275,29 @@ void Atmos3DDelayAudioProcessorEditor::buildElements()
     lowCutSlider.setRange(50.0f, 15000.0f); lowCutSlider.setTextValueSuffix(" Hz");
     addAndMakeVisible(&lowCutSlider);
 
+    //Building the Damping Bars
+    dampLowpassVal = make_unique<AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.parameters, "dampLowpass", dampHighCutSlider);
+    dampHighCutSlider.setSliderStyle(Slider::SliderStyle::LinearBar);
+    dampHighCutSlider.setTextValueSuffix(" Hz");
+    dampHighCutSlider.setTooltip("High cut of the repeats");
+    addAndMakeVisible(&dampHighCutSlider);
+
+    dampHighpassVal = make_unique<AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.parameters, "dampHighpass", dampLowCutSlider);
+    dampLowCutSlider.setSliderStyle(Slider::SliderStyle::LinearBar);
+    dampLowCutSlider.setTextValueSuffix(" Hz");
+    dampLowCutSlider.setTooltip("Low cut of the repeats");
+    addAndMakeVisible(&dampLowCutSlider);
+
     //Building the Output Gain
     outputGainVal = make_unique<AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.parameters, "outGain", outputGainSlider);
     outputGainSlider.setSliderStyle(Slider::SliderStyle::LinearVertical);
     outputGainSlider.setTextBoxStyle(Slider::TextBoxBelow, false, 100, 20);
     outputGainSlider.setRange(0.0f, 2.0f);
     addAndMakeVisible(&outputGainSlider);
+
+    addAndMakeVisible(&levelMeters);
+
+    addAndMakeVisible(&echoView);
+
+    updateModeControls();
 }
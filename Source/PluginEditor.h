@@ -10,6 +10,9 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "EchoPositionView.h"
+#include "LevelMeterComponent.h"
+#include "StaticLayer.h"
 
 using namespace juce;
 using namespace std;
@@ -28,6 +31,8 @@ public:
     void resized() override;
     void timerCallback() override;
     void buildElements();
+    void drawStaticLayer(Graphics& g);
+    void updateModeControls();
 
     unique_ptr<AudioProcessorValueTreeState::SliderAttachment> inputGainVal;        // Attachment for Input Gain
 
@@ -39,9 +44,13 @@ public:
 
     unique_ptr<AudioProcessorValueTreeState::SliderAttachment> lowpassVal;          // Attachment for Low Pass Value
     unique_ptr<AudioProcessorValueTreeState::SliderAttachment> highpassVal;          // Attachment for Low Pass Value
+    unique_ptr<AudioProcessorValueTreeState::SliderAttachment> dampLowpassVal;       // Attachment for Damping Low Pass
+    unique_ptr<AudioProcessorValueTreeState::SliderAttachment> dampHighpassVal;      // Attachment for Damping High Pass
 
     unique_ptr<AudioProcessorValueTreeState::SliderAttachment> outputGainVal;       // Attachment for Output Gain
     unique_ptr<AudioProcessorValueTreeState::ComboBoxAttachment> delayOptVal;          // Attachment for Delay Option Value
+    unique_ptr<AudioProcessorValueTreeState::ComboBoxAttachment> interpolationVal;     // Attachment for Interpolation Value
+    unique_ptr<AudioProcessorValueTreeState::ComboBoxAttachment> networkVal;           // Attachment for Delay Network Value
 
 private:
     // This reference is provided as a quick way for your editor to
@@ -58,13 +67,26 @@ private:
 
     Slider      lowCutSlider;           // Slider for Low Cut
     Slider      highCutSlider;          // Slider for High Cut
+    Slider      dampHighCutSlider;      // High cut of the repeats
+    Slider      dampLowCutSlider;       // Low cut of the repeats
 
     Slider      outputGainSlider;       // Slider for Output Gain
 
     ComboBox    delayOptions;       // Options of Delay
+    ComboBox    interpolationOptions;   // Quality of the delay taps
+    ComboBox    networkOptions;         // Multi-Tap or FDN in place of the delay option
 
     Label       balanceText;
     Label       offsetText;
 
+    // Fed from the processor's LevelMeter by the 60 Hz timer
+    LevelMeterComponent levelMeters;
+    EchoPositionView    echoView;
+    MeterSnapshot       meterSnapshot;
+    AudioChannelSet     shownOutput, shownInput;        // Buses the echo view's speakers were built from
+
+    // Background, panels and labels, drawn once per resize
+    StaticLayer         staticLayer;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Atmos3DDelayAudioProcessorEditor)
 };
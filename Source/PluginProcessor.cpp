@@ -23,15 +23,18 @@ Atmos3DDelayAudioProcessor::Atmos3DDelayAudioProcessor()
                        .withOutput ("Output", juce::AudioChannelSet::create7point1point2(), true)
                      #endif
                         ), parameters(*this, nullptr, "Parameter", createParameters()),
-                           lowPassFilter(dsp::IIR::Coefficients<float>::makeLowPass(48000, 20000.0f, 0.8f)),
-                           highPassFilter(dsp::IIR::Coefficients<float>::makeHighPass(48000, 15000.0f, 0.8f))
+                           parameterCache(parameters)
 
 #endif
 {
+    presetBank.prepare(parameters);
+    setTapPattern(TapPattern::createDefault());
+    startTimerHz(30);
 }
 
 Atmos3DDelayAudioProcessor::~Atmos3DDelayAudioProcessor()
 {
+    stopTimer();
 }
 
 //==============================================================================
@@ -69,67 +72,235 @@ bool Atmos3DDelayAudioProcessor::isMidiEffect() const
 
 double Atmos3DDelayAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    const double delayTime = parameters.getRawParameterValue("delayTime")->load();
+    const double offset = parameters.getRawParameterValue("offset")->load();
+    const double feedback = parameters.getRawParameterValue("feedback")->load();
+    const int option = ParameterSnapshot::getDelayMode(roundToInt(parameters.getRawParameterValue("delay_option")->load()),
+                                                       roundToInt(parameters.getRawParameterValue("delay_network")->load()));
+
+    // Longest read head, and the most of the line one pass round the feedback loop keeps.
+    // Damping only makes the repeats die away sooner, so it is left out.
+    double longestDelay = delayTime + std::abs(offset);
+    double loopGain = feedback;
+
+    if (option == 3)
+    {
+        const auto pattern = getTapPattern();
+        longestDelay = delayTime * pattern.getLongestTime();
+        loopGain *= pattern.getTotalFeedback();
+    }
+    else if (option == 4)
+    {
+        // Every FDN line is at most Delay Time long, and loses Feedback per Delay Time
+        longestDelay = delayTime;
+    }
+
+    if (loopGain >= 1.0)
+        return std::numeric_limits<double>::infinity();
+
+    // Repeats until they fall below silenceThreshold, each one a longest delay after the last
+    const double repeats = loopGain > 0.0 ? std::ceil(std::log((double)silenceThreshold) / std::log(loopGain)) : 0.0;
+    return longestDelay * (1.0 + repeats);
 }
 
 int Atmos3DDelayAudioProcessor::getNumPrograms()
 {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
+    return presetBank.size();
 }
 
 int Atmos3DDelayAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    return currentProgram;
 }
 
+// The audio thread takes the program's prepared snapshot and pattern from the bank at its next block, all at once
 void Atmos3DDelayAudioProcessor::setCurrentProgram (int index)
 {
+    if (! isPositiveAndBelow(index, presetBank.size()))
+        return;
+
+    const auto& preset = presetBank[index];
+    currentProgram = index;
+    setParameterScene(preset.values, index);
+    setTapPattern(preset.tapPattern);
 }
 
 const juce::String Atmos3DDelayAudioProcessor::getProgramName (int index)
 {
-    return {};
+    return isPositiveAndBelow(index, presetBank.size()) ? presetBank[index].name : String();
 }
 
+// Factory programs keep their names
 void Atmos3DDelayAudioProcessor::changeProgramName (int index, const juce::String& newName)
 {
 }
 
+void Atmos3DDelayAudioProcessor::setParameterScene(const ParameterSnapshot& values, int program)
+{
+    parameterGeneration.fetch_add(1, std::memory_order_acq_rel);
+
+    for (int i = 0; i < ParameterSnapshot::numParameters; ++i)
+        if (auto* parameter = parameters.getParameter(ParameterSnapshot::parameterIDs[i]))
+            parameter->setValueNotifyingHost(parameter->convertTo0to1(values.getValue(i)));
+
+    if (program >= 0)
+        pendingProgram.store(program, std::memory_order_release);
+
+    parameterGeneration.fetch_add(1, std::memory_order_release);
+}
+
+void Atmos3DDelayAudioProcessor::refreshParameters() noexcept
+{
+    // A program arrives whole, already rounded to what the parameters hold, so nothing is looked up or parsed here
+    const int program = pendingProgram.exchange(-1, std::memory_order_acquire);
+
+    if (program >= 0)
+    {
+        const auto& preset = presetBank[program];
+        snapshot = preset.values;
+        snapshot.markAllChanged();
+        tapPattern = preset.tapPattern;
+        return;
+    }
+
+    // Hold the last complete scene while one is being written, and drop a refresh that overlapped the write
+    const uint32 generation = parameterGeneration.load(std::memory_order_acquire);
+
+    if ((generation & 1) != 0)
+        return;
+
+    const auto previous = snapshot;
+    parameterCache.refresh(snapshot);
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if (parameterGeneration.load(std::memory_order_relaxed) != generation)
+        snapshot = previous;
+}
+
 //==============================================================================
 void Atmos3DDelayAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
+    // Channel roles for the current bus layout; the modes rebuild their routing from these
+    speakerLayout.build(getChannelLayoutOfBus(false, 0), getBusCount(true) > 0 ? getChannelLayoutOfBus(true, 0) : AudioChannelSet::stereo());
+    panner.prepare(speakerLayout);
+
     // Reset Delay Buffer information
-    float maxDelayTime = parameters.getParameterRange("delayTime").end;
-    delayBufferChannels = getTotalNumInputChannels();
-    delayBufferSamples = (int)(maxDelayTime * (float)sampleRate) + 1;
-    delayBuffer0Channels = getTotalNumInputChannels();
-    delayBuffer0Samples = (int)(maxDelayTime * (float)sampleRate) + 2;
+    // The rear/left read head sits at delayTime + offset, so leave room for both.
+    // Only delayed channels get a lane, so the LFE costs no history.
+    float maxDelayTime = parameters.getParameterRange("delayTime").end + parameters.getParameterRange("offset").end;
+    delayLine.prepare(speakerLayout.numLanes, (int)(maxDelayTime * (float)sampleRate) + 1,
+                      isCompactHistory() ? DelayLine::Format::int16
+                                         : (isUsingDoublePrecision() ? DelayLine::Format::float64 : DelayLine::Format::float32));
+    interpolator.prepare();
+
+    // Everything derived from parameters has to be rebuilt for the new sample rate
+    parameterCache.refresh(snapshot);
+    snapshot.markAllChanged();
+
+    startGain = snapshot.inputGain;
+    finalGain = snapshot.outputGain;
+
+    quietSamples = 0;
+    idle = false;
+    parameterEvents.clear();
+    levelMeter.prepare(sampleRate);
 
-    if (delayBufferSamples < 1) { delayBufferSamples = 1; }
+    //Pre-processing for LOW, HIGH, BAND PASS FILTERS
+    lastSampleRate = (float)sampleRate;
 
-    delayBuffer.setSize(delayBufferChannels, delayBufferSamples);
-    delayBuffer0.setSize(delayBuffer0Channels, delayBuffer0Samples);
-    delayBuffer.clear();
-    delayBuffer0.clear();
-    delayWritePosition = 0;
+    lowpassCutoff.reset(sampleRate, 0.05);
+    lowpassCutoff.setCurrentAndTargetValue(snapshot.lowpass);
+    updateLowpassFilter(snapshot.lowpass);
 
-    //Pre-processing for LOW, HIGH, BAND PASS FILTERS
-    dsp::ProcessSpec spec;
-    spec.sampleRate = sampleRate;
-    spec.maximumBlockSize = samplesPerBlock;
-    spec.numChannels = getTotalNumOutputChannels();
+    highpassCutoff.reset(sampleRate, 0.05);
+    highpassCutoff.setCurrentAndTargetValue(snapshot.highpass);
+    updateHighpassFilter(snapshot.highpass);
 
-    lowPassFilter.prepare(spec);
-    lowPassFilter.reset();
-    highPassFilter.prepare(spec);
-    highPassFilter.reset();
+    outputFilter.reset();
+    outputFilterDouble.reset();
+
+    // One group per channelsPerGroup channels, at most one per core; the audio thread takes a group too
+    const int numChannels = jmin(getTotalNumOutputChannels(), SpeakerLayout::maxChannels);
+    const int maxGroups = jmin((numChannels + channelsPerGroup - 1) / channelsPerGroup, SystemStats::getNumCpus(), WorkerPool::maxWorkers + 1);
+
+    workerPool.start(isParallelProcessing() && maxGroups > 1 ? maxGroups - 1 : 0);
+    numChannelGroups = workerPool.getNumWorkers() + 1;
+
+    // Blocks longer than this are crossfaded in pieces, so a host going over samplesPerBlock never allocates
+    const int dryChannels = jmax(getTotalNumInputChannels(), 1), drySamples = jmax(samplesPerBlock, 64);
+    bypassDryBuffer.setSize(isUsingDoublePrecision() ? 0 : dryChannels, isUsingDoublePrecision() ? 0 : drySamples);
+    bypassDryBufferDouble.setSize(isUsingDoublePrecision() ? dryChannels : 0, isUsingDoublePrecision() ? drySamples : 0);
+    bypassFade.reset(sampleRate, 0.02);
+    bypassFade.setCurrentAndTargetValue(bypassFade.getTargetValue());
+    bypassRingOut = isBypassRingOut();
+}
+
+void Atmos3DDelayAudioProcessor::setCompactHistory(bool shouldBeCompact)
+{
+    parameters.state.setProperty(compactHistoryProperty, shouldBeCompact, nullptr);
+}
+
+bool Atmos3DDelayAudioProcessor::isCompactHistory() const
+{
+    return parameters.state.getProperty(compactHistoryProperty, false);
+}
+
+void Atmos3DDelayAudioProcessor::setBypassRingOut(bool shouldRingOut)
+{
+    parameters.state.setProperty(bypassRingOutProperty, shouldRingOut, nullptr);
+}
+
+bool Atmos3DDelayAudioProcessor::isBypassRingOut() const
+{
+    return parameters.state.getProperty(bypassRingOutProperty, false);
+}
+
+size_t Atmos3DDelayAudioProcessor::getDelayHistoryBytes() const
+{
+    return delayLine.getNumBytes();
+}
+
+void Atmos3DDelayAudioProcessor::setTapPattern(const TapPattern& newPattern)
+{
+    {
+        const SpinLock::ScopedLockType lock(tapPatternLock);
+        pendingTapPattern = newPattern;
+    }
+
+    tapPatternChanged = true;
+
+    auto tree = parameters.state.getChildWithName(TapPattern::type);
+    if (tree.isValid()) { parameters.state.removeChild(tree, nullptr); }
+    parameters.state.appendChild(newPattern.toValueTree(), nullptr);
+}
+
+TapPattern Atmos3DDelayAudioProcessor::getTapPattern() const
+{
+    const SpinLock::ScopedLockType lock(tapPatternLock);
+    return pendingTapPattern;
+}
+
+void Atmos3DDelayAudioProcessor::setParallelProcessing(bool shouldBeParallel)
+{
+    parameters.state.setProperty(parallelProcessingProperty, shouldBeParallel, nullptr);
+}
+
+bool Atmos3DDelayAudioProcessor::isParallelProcessing() const
+{
+    return parameters.state.getProperty(parallelProcessingProperty, false);
+}
+
+int Atmos3DDelayAudioProcessor::getNumWorkerThreads() const
+{
+    return workerPool.getNumWorkers();
 }
 
 void Atmos3DDelayAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    workerPool.stop();
+    numChannelGroups = 1;
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -139,115 +310,446 @@ bool Atmos3DDelayAudioProcessor::isBusesLayoutSupported(const BusesLayout& layou
     juce::ignoreUnused(layouts);
     return true;
 #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-        if (layouts.getMainOutputChannelSet() == juce::AudioChannelSet::create7point1point2()) { return true; }
-        else { return false; }
+    // Any surround or immersive output with a left/right pair (5.1, 5.1.2, 7.1.2, 7.1.4, 9.1.6, ...).
+    // The input is the stereo source, either on its own, mono, or as the front pair of the output layout.
+    const auto output = layouts.getMainOutputChannelSet();
+    const auto input = layouts.getMainInputChannelSet();
+
+    if (! SpeakerLayout::isSupported(output))
+        return false;
+
+    return input == output || input == AudioChannelSet::stereo() || input == AudioChannelSet::mono();
 #endif
 }
 #endif
 
-void Atmos3DDelayAudioProcessor::updateLowpassFilter()
+// Both update functions write coefficients straight into the filter's stages, so nothing is allocated on the audio thread
+void Atmos3DDelayAudioProcessor::updateLowpassFilter(float cutoff)
 {
-   auto lowpassFreq = parameters.getParameterAsValue("lowpass");
-       float currentLowCutOff = lowpassFreq.getValue();
-       *lowPassFilter.state = *dsp::IIR::Coefficients<float>::makeLowPass(lastSampleRate, currentLowCutOff, 0.8f);
+    if (isUsingDoublePrecision())
+        outputFilterDouble.setCoefficients(lowpassStage, dsp::IIR::ArrayCoefficients<double>::makeLowPass(lastSampleRate, jmin(cutoff, 0.49f * lastSampleRate), 0.8));
+    else
+        outputFilter.setCoefficients(lowpassStage, dsp::IIR::ArrayCoefficients<float>::makeLowPass(lastSampleRate, jmin(cutoff, 0.49f * lastSampleRate), 0.8f));
 }
-void Atmos3DDelayAudioProcessor::updateHighpassFilter()
+void Atmos3DDelayAudioProcessor::updateHighpassFilter(float cutoff)
 {
-      auto highpassFreq = parameters.getParameterAsValue("highpass");
-    float currentHighCutOff = highpassFreq.getValue();
-    *highPassFilter.state = *dsp::IIR::Coefficients<float>::makeHighPass(lastSampleRate, currentHighCutOff, 0.8f);
+    if (isUsingDoublePrecision())
+        outputFilterDouble.setCoefficients(highpassStage, dsp::IIR::ArrayCoefficients<double>::makeHighPass(lastSampleRate, jmin(cutoff, 0.49f * lastSampleRate), 0.8));
+    else
+        outputFilter.setCoefficients(highpassStage, dsp::IIR::ArrayCoefficients<float>::makeHighPass(lastSampleRate, jmin(cutoff, 0.49f * lastSampleRate), 0.8f));
 }
 
 void Atmos3DDelayAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
-    //========= Variables ===================================//
+    ATMOS_REALTIME_SCOPE("Atmos3DDelayAudioProcessor::processBlock");
+    processHostBlock(buffer, false);
+}
+
+void Atmos3DDelayAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    ATMOS_REALTIME_SCOPE("Atmos3DDelayAudioProcessor::processBlock");
+    processHostBlock(buffer, false);
+}
+
+void Atmos3DDelayAudioProcessor::processBlockBypassed (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    ATMOS_REALTIME_SCOPE("Atmos3DDelayAudioProcessor::processBlockBypassed");
+    processHostBlock(buffer, true);
+}
+
+void Atmos3DDelayAudioProcessor::processBlockBypassed (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    ATMOS_REALTIME_SCOPE("Atmos3DDelayAudioProcessor::processBlockBypassed");
+    processHostBlock(buffer, true);
+}
+
+// A double host gets double arithmetic and history all the way through, unless the history is compact
+bool Atmos3DDelayAudioProcessor::supportsDoublePrecisionProcessing() const
+{
+    return true;
+}
+
+template <typename FloatType>
+void Atmos3DDelayAudioProcessor::processHostBlock(AudioBuffer<FloatType>& buffer, bool bypassed)
+{
     ScopedNoDenormals noDenormals;
 
-    auto dTime      = parameters.getRawParameterValue("delayTime");
-    auto mix        = parameters.getRawParameterValue("mix");
-    auto feedback   = parameters.getRawParameterValue("feedback");
-    auto balance    = parameters.getRawParameterValue("balance");
-    auto choice     = parameters.getRawParameterValue("delay_option");
-    auto offset     = parameters.getRawParameterValue("offset");
+    bypassFade.setTargetValue(bypassed ? 1.0f : 0.0f);
+    parameterEvents.collect();
 
-    currentDelayTime    = (dTime->load()) * (float)getSampleRate();
-    currentMix          = (mix->load());
-    currentFeedback     = feedback->load();
-    currentBalance      = balance->load();
-    currentChoice       = choice->load();
-    currentOffset       = (offset->load()) * (float)getSampleRate();
+    // Queued changes split the block: each sub-block runs the whole chain on the parameters of its first sample
+    const int numSamples = buffer.getNumSamples();
 
-    int localWritePosition = delayWritePosition;
+    for (int start = 0; start < numSamples;)
+    {
+        parameterEvents.popDue(start, [this] (const ParameterChange& change)
+        {
+            parameterCache.apply(snapshot, change.parameterIndex, change.value);
+        });
 
-    //========== Processing =================================//
-    
-    // Gain control of input signal
-    inputGainControl(buffer);
+        const int end = jmin(numSamples, parameterEvents.getNextOffset());
+        AudioBuffer<FloatType> subBlock(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), start, end - start);
+
+        // Only bypassed blocks and the ones either side of a bypass change pay for the crossfade
+        if (bypassFade.isSmoothing() || bypassFade.getCurrentValue() > 0.0f)
+            processWithBypass(subBlock);
+        else
+            processChain(subBlock);
+
+        start = end;
+    }
+
+    parameterEvents.advance(numSamples);
+
+    // Meters see the whole host block, however it was split; an idle line has nothing in it to measure
+    levelMeter.measure(buffer, getTotalNumOutputChannels());
+
+    if (! idle)
+        levelMeter.measureHistory(delayLine.getRecentPeak(numSamples), delayLine.getRecentMeanSquare(numSamples), numSamples);
+
+    if (levelMeter.isReadyToPublish())
+        levelMeter.measureEchoes(delayRouting, speakerLayout, getSampleRate());
+
+    levelMeter.publish();
+}
+
+bool Atmos3DDelayAudioProcessor::queueParameterChange(int parameterIndex, float normalisedValue, int sampleOffset)
+{
+    return parameterEvents.push({ parameterIndex, normalisedValue, sampleOffset });
+}
+
+void Atmos3DDelayAudioProcessor::notifyQueuedParameterChanges()
+{
+    parameterCache.notifyApplied();
+}
+
+void Atmos3DDelayAudioProcessor::timerCallback()
+{
+    notifyQueuedParameterChanges();
+}
+
+template <typename FloatType>
+void Atmos3DDelayAudioProcessor::processWithBypass(AudioBuffer<FloatType>& buffer)
+{
+    // While bypassed the chain keeps running on silence, so the echoes decay and the filters stay warm instead of
+    // freezing until the bypass is lifted. Idle detection makes that close to free once the echoes have died away.
+    auto& dry = getBypassDryBuffer<FloatType>();
+    jassert(dry.getNumSamples() > 0);   // prepareToPlay has not been called for this precision
+
+    if (dry.getNumSamples() == 0)
+        return;
+
+    const int numInputs = jmin(getTotalNumInputChannels(), buffer.getNumChannels(), dry.getNumChannels());
 
-    // Perform DSP below
+    for (int start = 0; start < buffer.getNumSamples(); start += dry.getNumSamples())
+    {
+        AudioBuffer<FloatType> chunk(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), start,
+                                 jmin(dry.getNumSamples(), buffer.getNumSamples() - start));
+
+        const int numSamples = chunk.getNumSamples();
+        const auto fadeStart = (FloatType)bypassFade.getCurrentValue();
+        const auto fadeEnd = (FloatType)bypassFade.skip(numSamples);
+
+        // The bypassed signal is the input passed straight through, faded in
+        for (int channel = 0; channel < numInputs; ++channel)
+            dry.copyFromWithRamp(channel, 0, chunk.getReadPointer(channel), numSamples, fadeStart, fadeEnd);
+
+        // and the delay hears less and less of the input, so its history has no edge either
+        for (int channel = 0; channel < numInputs; ++channel)
+            chunk.applyGainRamp(channel, 0, numSamples, 1 - fadeStart, 1 - fadeEnd);
+
+        processChain(chunk);
+
+        // Without ring-out, the echoes already in the line fade out with the rest of the processed signal
+        if (! bypassRingOut)
+            chunk.applyGainRamp(0, numSamples, 1 - fadeStart, 1 - fadeEnd);
+
+        for (int channel = 0; channel < numInputs; ++channel)
+            chunk.addFrom(channel, 0, dry, channel, 0, numSamples);
+    }
+}
+
+template <typename FloatType>
+void Atmos3DDelayAudioProcessor::processChain(AudioBuffer<FloatType>& buffer)
+{
+    //========= Variables ===================================//
+    refreshParameters();
+
+    if (snapshot.hasChanged(ParameterSnapshot::delayTimeChanged | ParameterSnapshot::offsetChanged))
+    {
+        currentDelayTime    = snapshot.delayTime * (float)getSampleRate();
+        currentOffset       = snapshot.offset * (float)getSampleRate();
+    }
+
+    currentMix          = snapshot.mix;
+    currentFeedback     = snapshot.feedback;
+    currentBalance      = snapshot.balance;
+    currentChoice       = snapshot.getDelayMode();
+
+    if (snapshot.hasChanged(ParameterSnapshot::interpolationChanged))
+        interpolator.setType((Interpolator::Type)jlimit(0, (int)Interpolator::sinc, snapshot.interpolation));
+
+    // Either damping filter is switched off at its end of the range, so the default repeats are untouched
+    if (snapshot.hasChanged(ParameterSnapshot::dampLowpassChanged))
+        dampLowpassCoefficient = snapshot.dampLowpass >= dampLowpassOff
+                                    ? 1.0f : 1.0f - std::exp(-MathConstants<float>::twoPi * snapshot.dampLowpass / (float)getSampleRate());
+    if (snapshot.hasChanged(ParameterSnapshot::dampHighpassChanged))
+        dampHighpassCoefficient = snapshot.dampHighpass <= dampHighpassOff
+                                    ? 0.0f : 1.0f - std::exp(-MathConstants<float>::twoPi * snapshot.dampHighpass / (float)getSampleRate());
+
+    // Delay routing for this block
     if (currentChoice == 0)
-        PingPongDelay(buffer, localWritePosition);
+        PingPongDelay();
     else if (currentChoice == 1)
-       SlapBackDelay(buffer, localWritePosition);
+       SlapBackDelay();
     else if (currentChoice==2)
-       MidSideDelay(buffer, localWritePosition);
+       MidSideDelay();
+    else if (currentChoice == 3)
+       MultiTapDelay();
+    else if (currentChoice == 4)
+       FeedbackDelayNetwork();
+
+    // Modes rebuild the routing from scratch, so the damping goes on top of whatever they built
+    delayRouting.setDamping(dampLowpassCoefficient, dampHighpassCoefficient);
+
+    // A float64 history runs on a double copy of the tables, which is only redone when they have changed
+    if (delayLine.getFormat() == DelayLine::Format::float64)
+        delayRouting.widenGains();
+
+    if (snapshot.hasChanged(ParameterSnapshot::lowpassChanged))
+        lowpassCutoff.setTargetValue(snapshot.lowpass);
+    if (snapshot.hasChanged(ParameterSnapshot::highpassChanged))
+        highpassCutoff.setTargetValue(snapshot.highpass);
+
+    // Filters and output gain are per channel, so on large layouts they run as channel groups over the worker pool,
+    // once the whole block has been through the delay. Gliding cutoffs share their coefficient updates across
+    // channels, so those blocks stay on this thread.
+    // Silent input with nothing audible left in the delay history can only give silence, so skip the chain
+    const bool inputSilent = isSilent(buffer, getTotalNumInputChannels());
+
+    if (idle && inputSilent)
+    {
+        processIdleBlock(buffer);
+        snapshot.clearChanges();
+        return;
+    }
+
+    idle = false;
 
-    lpFilter(buffer);
-    hpFilter(buffer);
+    const bool parallel = numChannelGroups > 1 && workerPool.isUsable() && buffer.getNumSamples() >= minParallelBlockSize
+                          && ! lowpassCutoff.isSmoothing() && ! highpassCutoff.isSmoothing();
+
+    //========== Processing =================================//
 
-    // Gain control of output signal
-    outputGainControl(buffer);
-    
-    // This is here to avoid people getting screaming feedback when they first compile a plugin
-    for (auto i = getTotalNumOutputChannels(); i < getTotalNumOutputChannels(); ++i) { buffer.clear(i, 0, buffer.getNumSamples()); }
+    // Every stage runs on one tile before the next tile starts, so the tile stays in L1 from input gain to output gain
+    const int blockLength = buffer.getNumSamples();
+    const int tileLength = tileSize > 0 ? tileSize : blockLength;
+    const int numChannels = jmin(buffer.getNumChannels(), SpeakerLayout::maxChannels);
+
+    for (int tileStart = 0; tileStart < blockLength; tileStart += tileLength)
+    {
+        AudioBuffer<FloatType> tile(buffer.getArrayOfWritePointers(), numChannels, tileStart, jmin(tileLength, blockLength - tileStart));
+
+        // Output channels with no matching input hold garbage until the delay writes them
+        for (auto i = getTotalNumInputChannels(); i < getTotalNumOutputChannels(); ++i) { tile.clear(i, 0, tile.getNumSamples()); }
+
+        // Gain control of input signal
+        inputGainControl(tile, tileStart, blockLength);
+
+        // Perform DSP below
+        processDelay(tile);
+
+        if (! parallel)
+        {
+            filterOutput(tile);
+
+            // Gain control of output signal
+            outputGainControl(tile, tileStart, blockLength);
+        }
+    }
+
+    startGain = snapshot.inputGain;
+
+    if (parallel)
+        processChannelGroups(buffer);
+    else
+        finalGain = snapshot.outputGain;
+
+    updateIdleState(inputSilent, blockLength);
+
+    snapshot.clearChanges();
+}
+
+template <typename FloatType>
+bool Atmos3DDelayAudioProcessor::isSilent(const AudioBuffer<FloatType>& buffer, int numChannels)
+{
+    for (int channel = 0; channel < jmin(numChannels, buffer.getNumChannels()); ++channel)
+    {
+        const auto range = FloatVectorOperations::findMinAndMax(buffer.getReadPointer(channel), buffer.getNumSamples());
+
+        if (jmax(-range.getStart(), range.getEnd()) >= silenceThreshold)
+            return false;
+    }
+
+    return true;
+}
+
+void Atmos3DDelayAudioProcessor::updateIdleState(bool inputSilent, int numSamples)
+{
+    // Counts samples for which nothing audible has gone in, or been written back into the history
+    if (inputSilent && delayLine.getRecentPeak(numSamples) < silenceThreshold)
+        quietSamples += numSamples;
+    else
+        quietSamples = 0;
+
+    // Once that has lasted the longest read distance, every read head only sees quiet history
+    if (quietSamples > (int64)getLongestReadDistance())
+    {
+        // Drop what is left below the threshold, so the next sound starts from a clean line
+        delayLine.clear();
+        outputFilter.reset();
+        outputFilterDouble.reset();
+        quietSamples = 0;
+        idle = true;
+    }
+}
+
+template <typename FloatType>
+void Atmos3DDelayAudioProcessor::processIdleBlock(AudioBuffer<FloatType>& buffer)
+{
+    buffer.clear();
+
+    // Leave the gains and cutoffs where a processed block would have, so the next one carries on from there
+    startGain = snapshot.inputGain;
+    finalGain = snapshot.outputGain;
+
+    if (lowpassCutoff.isSmoothing())
+        updateLowpassFilter(lowpassCutoff.skip(buffer.getNumSamples()));
+    if (highpassCutoff.isSmoothing())
+        updateHighpassFilter(highpassCutoff.skip(buffer.getNumSamples()));
+}
+
+bool Atmos3DDelayAudioProcessor::isIdle() const
+{
+    return idle;
 }
 
-void Atmos3DDelayAudioProcessor::lpFilter(AudioBuffer<float>& inBuffer)
+int Atmos3DDelayAudioProcessor::getLongestReadDistance() const
 {
-    AudioBlock <float> block(inBuffer);
-    updateLowpassFilter();
-    lowPassFilter.process(ProcessContextReplacing<float>(block));
+    return (int)delayRouting.getLongestDelay() + Interpolator::maxPoints;
 }
 
-void Atmos3DDelayAudioProcessor::hpFilter(AudioBuffer<float>& inBuffer)
+LevelMeter& Atmos3DDelayAudioProcessor::getLevelMeter() noexcept
 {
-    AudioBlock <float> block(inBuffer);
-    updateHighpassFilter();
-    highPassFilter.process(ProcessContextReplacing<float>(block));
+    return levelMeter;
 }
 
-void Atmos3DDelayAudioProcessor::inputGainControl(AudioBuffer<float>& buffer)
+void Atmos3DDelayAudioProcessor::setTileSize(int numFrames)
 {
-    auto gain = parameters.getRawParameterValue("inGain");
-    float gainValue = gain->load();
-    if (gainValue == startGain)
+    tileSize = jmax(0, numFrames);
+}
+
+int Atmos3DDelayAudioProcessor::getTileSize() const
+{
+    return tileSize;
+}
+
+template <typename FloatType>
+void Atmos3DDelayAudioProcessor::filterOutput(AudioBuffer<FloatType>& buffer)
+{
+    auto& filter = getOutputFilter<FloatType>();
+    const int numChannels = jmin(buffer.getNumChannels(), SpeakerLayout::maxChannels);
+
+    if (! lowpassCutoff.isSmoothing() && ! highpassCutoff.isSmoothing())
     {
-        buffer.applyGain(gainValue);
+        filter.process(buffer.getArrayOfWritePointers(), 0, numChannels, buffer.getNumSamples());
+        return;
     }
-    else
+
+    // While a cutoff moves, refresh the coefficients at a fixed control rate
+    FloatType* channels[SpeakerLayout::maxChannels];
+
+    for (int start = 0; start < buffer.getNumSamples(); start += filterUpdateInterval)
     {
-        buffer.applyGainRamp(0, buffer.getNumSamples(), startGain, gainValue);
-        startGain = gainValue;
+        const int numSamples = jmin(filterUpdateInterval, buffer.getNumSamples() - start);
+
+        if (lowpassCutoff.isSmoothing())
+            updateLowpassFilter(lowpassCutoff.skip(numSamples));
+        if (highpassCutoff.isSmoothing())
+            updateHighpassFilter(highpassCutoff.skip(numSamples));
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            channels[channel] = buffer.getWritePointer(channel, start);
+
+        filter.process(channels, 0, numChannels, numSamples);
     }
 }
 
-void Atmos3DDelayAudioProcessor::outputGainControl(AudioBuffer<float>& buffer)
+template <typename FloatType>
+void Atmos3DDelayAudioProcessor::processChannelGroups(AudioBuffer<FloatType>& buffer)
+{
+    // The output gain ramp is worked out once here, and every group applies the same one
+    groupGainStart = finalGain;
+    groupGainEnd = snapshot.outputGain;
+    finalGain = groupGainEnd;
+
+    currentGroupBuffer = &buffer;
+    workerPool.run(numChannelGroups, processChannelGroup<FloatType>, this);
+    currentGroupBuffer = nullptr;
+}
+
+template <typename FloatType>
+void Atmos3DDelayAudioProcessor::processChannelGroup(void* context, int group) noexcept
 {
-    auto gain = parameters.getRawParameterValue("outGain");
-    float gainValue = gain->load();
-    if (gainValue == finalGain)
+    auto& processor = *static_cast<Atmos3DDelayAudioProcessor*>(context);
+    auto& buffer = *static_cast<AudioBuffer<FloatType>*>(processor.currentGroupBuffer);
+
+    // Groups are whole registers of the filter, so no two threads share one's state
+    constexpr int lanes = MultichannelBiquad<FloatType>::lanes;
+    const int numChannels = jmin(buffer.getNumChannels(), SpeakerLayout::maxChannels);
+    const int groupSize = ((numChannels + processor.numChannelGroups - 1) / processor.numChannelGroups + lanes - 1) / lanes * lanes;
+    const int first = group * groupSize;
+    const int count = jmin(groupSize, numChannels - first);
+
+    if (count <= 0)
+        return;
+
+    processor.getOutputFilter<FloatType>().process(buffer.getArrayOfWritePointers() + first, first, count, buffer.getNumSamples());
+
+    for (int channel = first; channel < first + count; ++channel)
     {
-        buffer.applyGain(gainValue);
+        if (processor.groupGainStart == processor.groupGainEnd)
+            buffer.applyGain(channel, 0, buffer.getNumSamples(), (FloatType)processor.groupGainEnd);
+        else
+            buffer.applyGainRamp(channel, 0, buffer.getNumSamples(), (FloatType)processor.groupGainStart, (FloatType)processor.groupGainEnd);
     }
-    else
+}
+
+template <typename FloatType>
+void Atmos3DDelayAudioProcessor::inputGainControl(AudioBuffer<FloatType>& tile, int tileStart, int blockLength)
+{
+    applyGainRamp(tile, startGain, snapshot.inputGain, tileStart, blockLength);
+}
+
+template <typename FloatType>
+void Atmos3DDelayAudioProcessor::outputGainControl(AudioBuffer<FloatType>& tile, int tileStart, int blockLength)
+{
+    applyGainRamp(tile, finalGain, snapshot.outputGain, tileStart, blockLength);
+}
+
+// Gain changes ramp across the whole host block, and each tile applies its own stretch of the ramp
+template <typename FloatType>
+void Atmos3DDelayAudioProcessor::applyGainRamp(AudioBuffer<FloatType>& tile, float blockStartGain, float blockEndGain, int tileStart, int blockLength)
+{
+    if (blockStartGain == blockEndGain)
     {
-        buffer.applyGainRamp(0, buffer.getNumSamples(), finalGain, gainValue);
-        finalGain = gainValue;
+        tile.applyGain((FloatType)blockEndGain);
+        return;
     }
+
+    const float step = (blockEndGain - blockStartGain) / (float)blockLength;
+    tile.applyGainRamp(0, tile.getNumSamples(), (FloatType)(blockStartGain + step * (float)tileStart),
+                       (FloatType)(blockStartGain + step * (float)(tileStart + tile.getNumSamples())));
 }
 
 //==============================================================================
@@ -256,308 +758,170 @@ bool Atmos3DDelayAudioProcessor::hasEditor() const
     return true; // (change this to false if you choose to not supply an editor)
 }
 
-void Atmos3DDelayAudioProcessor::MidSideDelay(AudioBuffer<float>& buffer, int localWritePosition)
-{
-    float* leftchannelData = buffer.getWritePointer(0);
-    float* rightchannelData = buffer.getWritePointer(1);
-    float* centerchannelData = buffer.getWritePointer(2);
-    float* surroundleftchannelData = buffer.getWritePointer(6);
-    float* surroundrightchannelData = buffer.getWritePointer(7);
-    float* rearleftchannelData = buffer.getWritePointer(4);
-    float* rearrightchannelData = buffer.getWritePointer(5);
-    float* topleftchannelData = buffer.getWritePointer(8);
-    float* toprightchannelData = buffer.getWritePointer(9);
-
-    float* leftdelayData = delayBuffer.getWritePointer(0);
-    float* rightdelayData = delayBuffer.getWritePointer(1);
-    float* centerdelayData = delayBuffer.getWritePointer(2);
-    float* surroundleftdelayData = delayBuffer.getWritePointer(6);
-    float* surroundrightdelayData = delayBuffer.getWritePointer(7);
-    float* rearleftdelayData = delayBuffer.getWritePointer(4);
-    float* rearrightdelayData = delayBuffer.getWritePointer(5);
-    float* topleftdelayData = delayBuffer.getWritePointer(8);
-    float* toprightdelayData = delayBuffer.getWritePointer(9);
-
-    for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
+void Atmos3DDelayAudioProcessor::MidSideDelay()
+{
+    // The routing only depends on parameters, so keep last block's table unless one of them moved
+    if (snapshot.hasChanged(ParameterSnapshot::delayRoutingChanged))
     {
-        // Input samples for each channel
-        const float frontsampleInput = (1.0f - currentBalance) * leftchannelData[sample];
-        const float rearsampleInput = currentBalance * rightchannelData[sample];
-        const float centersampleInput = (leftchannelData[sample] + rightchannelData[sample]) / 2;
-
-        // Output samples for each channel
-        float leftsampleOutput = 0.0f;
-        float rightsampleOutput = 0.0f;
-        float centersampleOutput = 0.0f;
-        float surroundleftsampleOutput = 0.0f;
-        float surroundrightsampleOutput = 0.0f;
-        float rearleftsampleOutput = 0.0f;
-        float rearrightsampleOutput = 0.0f;
-        float topleftsampleOutput = 0.0f;
-        float toprightsampleOutput = 0.0f;
-
-        // Obtain the position to read and write from and to the buffer
-        float centerReadPosition = fmodf((float)localWritePosition - currentDelayTime + (float)delayBufferSamples, delayBufferSamples);
-        float rightReadPosition = fmodf((float)localWritePosition - (currentDelayTime - currentOffset) + (float)delayBufferSamples, delayBufferSamples);
-        float leftReadPosition = fmodf((float)localWritePosition - (currentDelayTime + currentOffset) + (float)delayBufferSamples, delayBufferSamples);
-
-
-        int centerLocalReadPosition = floorf(centerReadPosition);
-        int rightLocalReadPosition = floorf(rightReadPosition);
-        int leftLocalReadPosition = floorf(leftReadPosition);
-
-        if (centerLocalReadPosition != localWritePosition)
+        const float mid = 0.5f;
+        const float frontDry = 1.0f - 2.0f * currentMix;
+        const float rearDry = 1.0f - currentMix;
+
+        // One echo per speaker: left speakers late by the offset, right speakers early
+        delayRouting.reset(speakerLayout);
+
+        for (int channel = 0; channel < speakerLayout.numChannels; ++channel)
         {
-            //================================PROCESSING DELAY==========================================//
-            float centerFraction = centerReadPosition - (float)centerLocalReadPosition;
-            float rightFraction = rightReadPosition - (float)rightLocalReadPosition;
-            float leftFraction = leftReadPosition - (float)leftLocalReadPosition;
-
-            float delayed1L = leftdelayData[(leftLocalReadPosition + 0)];
-            float delayed1R = rightdelayData[(rightLocalReadPosition + 0)];
-            float delayed1C = centerdelayData[(centerLocalReadPosition + 0)];
-
-            float delayed2L = leftdelayData[(leftLocalReadPosition + 1) % delayBufferSamples];
-            float delayed2R = rightdelayData[(rightLocalReadPosition + 1) % delayBufferSamples];
-            float delayed2C = centerdelayData[(centerLocalReadPosition + 1) % delayBufferSamples];
-
-            float delayed3SL = surroundleftdelayData[(leftLocalReadPosition + 0)];
-            float delayed3SR = surroundrightdelayData[(rightLocalReadPosition + 0)];
-            float delayed4SL = surroundleftdelayData[(leftLocalReadPosition + 1) % delayBufferSamples];
-            float delayed4SR = surroundrightdelayData[(rightLocalReadPosition + 1) % delayBufferSamples];
-
-            float delayed5RL = rearleftdelayData[(leftLocalReadPosition + 0)];
-            float delayed5RR = rearrightdelayData[(rightLocalReadPosition + 0)];
-            float delayed5TL = topleftdelayData[(centerLocalReadPosition + 0)];
-            float delayed5TR = toprightdelayData[(centerLocalReadPosition + 0)];
-
-            float delayed6RL = rearleftdelayData[(leftLocalReadPosition + 1) % delayBufferSamples];
-            float delayed6RR = rearrightdelayData[(rightLocalReadPosition + 1) % delayBufferSamples];
-            float delayed6TL = topleftdelayData[(centerLocalReadPosition + 1) % delayBufferSamples];
-            float delayed6TR = toprightdelayData[(centerLocalReadPosition + 1) % delayBufferSamples];
-
-            leftsampleOutput = delayed1L + leftFraction * (delayed2L - delayed1L);
-            rightsampleOutput = delayed1R + rightFraction * (delayed2R - delayed1R);
-            centersampleOutput = delayed1C + centerFraction * (delayed2C - delayed1C);
-            surroundleftsampleOutput = delayed3SL + leftFraction * (delayed4SL - delayed3SL);
-            surroundrightsampleOutput = delayed3SR + rightFraction * (delayed4SR - delayed3SR);
-            rearleftsampleOutput = delayed5RL + leftFraction * (delayed6RL - delayed5RL);
-            rearrightsampleOutput = delayed5RR + rightFraction * (delayed6RR - delayed5RR);
-            topleftsampleOutput = delayed5TL + centerFraction * (delayed6TL - delayed5TL);
-            toprightsampleOutput = delayed5TL + centerFraction * (delayed6TL - delayed5TL);
-
-            //=========================MIX AND OUTPUT FOR CURRENT SAMPLE================================//
-            leftchannelData[sample] = centersampleInput * (1 - currentMix) + currentMix * (leftsampleOutput - centersampleInput);
-            rightchannelData[sample] = centersampleInput * (1 - currentMix) + currentMix * (rightsampleOutput - centersampleInput);
-            centerchannelData[sample] = currentMix * (centersampleOutput);
-            surroundleftchannelData[sample] = centersampleInput + currentMix * (surroundleftsampleOutput - centersampleInput);
-            surroundrightchannelData[sample] = centersampleInput + currentMix * (surroundrightsampleOutput - centersampleInput);
-            rearleftchannelData[sample] = centersampleInput + currentMix * (rearleftsampleOutput - centersampleInput);
-            rearrightchannelData[sample] = centersampleInput + currentMix * (rearrightsampleOutput - centersampleInput);
-            topleftchannelData[sample] = currentMix * (topleftsampleOutput);
-            toprightchannelData[sample] = currentMix * (toprightsampleOutput);
-
-            //leftdelayData[localWritePosition]           = centersampleInput       + rightsampleOutput         * currentFeedback;
-            //rightdelayData[localWritePosition]          = centersampleInput      + leftsampleOutput          * currentFeedback;
-            centerdelayData[localWritePosition] = centersampleInput;
-            surroundleftdelayData[localWritePosition] = (centersampleInput) + surroundleftsampleOutput * currentFeedback;
-            surroundrightdelayData[localWritePosition] = (centersampleInput) + surroundrightsampleOutput * currentFeedback;
-            rearleftdelayData[localWritePosition] = (centersampleInput) + rearleftsampleOutput * currentFeedback;
-            rearrightdelayData[localWritePosition] = (centersampleInput) + rearrightsampleOutput * currentFeedback;
-            topleftdelayData[localWritePosition] = centersampleInput + toprightsampleOutput * currentFeedback;
-            toprightdelayData[localWritePosition] = centersampleInput + topleftsampleOutput * currentFeedback;
+            const auto& speaker = speakerLayout.speakers[channel];
+            const float delay = speaker.side == SpeakerLayout::left  ? currentDelayTime + currentOffset
+                              : speaker.side == SpeakerLayout::right ? currentDelayTime - currentOffset
+                                                                     : currentDelayTime;
+
+            //                                                  channel  delay             input      dry        wet         history    feedback         source
+            switch (speaker.group)
+            {
+                case SpeakerLayout::front:      delayRouting.setChannel(channel, delay,            mid, mid,  frontDry,  currentMix, 0.0f, 0.0f, 0.0f,            channel);          break;
+                case SpeakerLayout::centre:     delayRouting.setChannel(channel, currentDelayTime, mid, mid,  0.0f,      currentMix, mid, mid,   0.0f,            channel);          break;
+                case SpeakerLayout::rear:
+                case SpeakerLayout::surround:   delayRouting.setChannel(channel, delay,            mid, mid,  rearDry,   currentMix, mid, mid,   currentFeedback, channel);          break;
+                case SpeakerLayout::top:        delayRouting.setChannel(channel, currentDelayTime, mid, mid,  0.0f,      currentMix, mid, mid,   currentFeedback, speaker.partner);  break;
+                case SpeakerLayout::passthrough:
+                default:                        break;
+            }
         }
+    }
+}
+
+void Atmos3DDelayAudioProcessor::PingPongDelay()
+{
+    // The routing only depends on parameters, so keep last block's table unless one of them moved
+    if (snapshot.hasChanged(ParameterSnapshot::delayRoutingChanged))
+    {
+        const float frontDry = 1.0f - 2.0f * currentMix;
+        const float rearDry = 1.0f - currentMix;
 
-        if (++localWritePosition >= delayBufferSamples) { localWritePosition -= delayBufferSamples; }
+        // One echo per speaker: the rear pair late by the offset, the surround pair early
+        const float frontDelay = currentDelayTime;
+        const float rearDelay = currentDelayTime + currentOffset;
+        const float surroundDelay = currentDelayTime - currentOffset;
 
-    }
+        delayRouting.reset(speakerLayout);
 
-    delayWritePosition = localWritePosition;
+        for (int channel = 0; channel < speakerLayout.numChannels; ++channel)
+        {
+            const auto& speaker = speakerLayout.speakers[channel];
+            const float left = (1.0f - currentBalance) * speaker.leftWeight();
+            const float right = currentBalance * speaker.rightWeight();
 
-    for (int channel = getTotalNumInputChannels(); channel < getTotalNumOutputChannels(); ++channel)
-        buffer.clear(channel, 0, buffer.getNumSamples());
+            //                                                  channel  delay          input          dry        wet         history      feedback         source
+            switch (speaker.group)
+            {
+                case SpeakerLayout::front:      delayRouting.setChannel(channel, frontDelay,    left, right,   frontDry,  currentMix, left, right, currentFeedback, speaker.partner);  break;
+                case SpeakerLayout::centre:     delayRouting.setChannel(channel, frontDelay,    0.0f, 0.0f,    0.0f,      currentMix, 0.5f, 0.5f,  0.0f,            channel);          break;
+                case SpeakerLayout::rear:       delayRouting.setChannel(channel, rearDelay,     left, right,   rearDry,   currentMix, left, right, currentFeedback, speaker.partner);  break;
+                case SpeakerLayout::surround:   delayRouting.setChannel(channel, surroundDelay, left, right,   rearDry,   currentMix, left, right, currentFeedback, speaker.partner);  break;
+                case SpeakerLayout::top:        delayRouting.setChannel(channel, frontDelay,    0.0f, 0.0f,    0.0f,      currentMix, left, right, currentFeedback, channel);          break;
+                case SpeakerLayout::passthrough:
+                default:                        break;
+            }
+        }
+    }
 }
 
-void Atmos3DDelayAudioProcessor::PingPongDelay(AudioBuffer<float>& buffer, int localWritePosition)
+void Atmos3DDelayAudioProcessor::SlapBackDelay()
 {
-    float* leftchannelData = buffer.getWritePointer(0);
-    float* rightchannelData = buffer.getWritePointer(1);
-    float* centerchannelData = buffer.getWritePointer(2);
-    float* surroundleftchannelData = buffer.getWritePointer(6);   
-    float* surroundrightchannelData = buffer.getWritePointer(7);  
-    float* rearleftchannelData = buffer.getWritePointer(4);       
-    float* rearrightchannelData = buffer.getWritePointer(5);     
-    float* topleftchannelData = buffer.getWritePointer(8);
-    float* toprightchannelData = buffer.getWritePointer(9);
+    // The routing only depends on parameters, so keep last block's table unless one of them moved
+    if (snapshot.hasChanged(ParameterSnapshot::delayRoutingChanged))
+    {
+        const float inputGain = 1.0f / sqrt(2.0f);
+        const float dry = 1.0f - 2.0f * currentMix;
 
-    float* leftdelayData = delayBuffer.getWritePointer(0);
-    float* rightdelayData = delayBuffer.getWritePointer(1);
-    float* centerdelayData = delayBuffer.getWritePointer(2);
-    float* surroundleftdelayData = delayBuffer.getWritePointer(6);  
-    float* surroundrightdelayData = delayBuffer.getWritePointer(7);   
-    float* rearleftdelayData = delayBuffer.getWritePointer(4);      
-    float* rearrightdelayData = delayBuffer.getWritePointer(5);     
-    float* topleftdelayData = delayBuffer.getWritePointer(8); 
-    float* toprightdelayData = delayBuffer.getWritePointer(9);
+        delayRouting.reset(speakerLayout);
 
-    for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
-    {
-         //Input samples for each channel
-        const float leftsampleInput = (1.0f - currentBalance) * leftchannelData[sample];
-        const float rightsampleInput = currentBalance * rightchannelData[sample]; 
-        const float centersampleInput = (leftchannelData[sample] + rightchannelData[sample]) / 2;
-
-         //Output samples for each channel
-        float leftsampleOutput = 0.0f;
-        float rightsampleOutput = 0.0f;
-        float centersampleOutput = 0.0f;
-        float surroundleftsampleOutput = 0.0f;
-        float surroundrightsampleOutput = 0.0f;
-        float rearleftsampleOutput = 0.0f;
-        float rearrightsampleOutput = 0.0f;
-        float topleftsampleOutput = 0.0f;
-        float toprightsampleOutput = 0.0f;
-
-         //Obtain the position to read and write from and to the buffer
-        float frontReadPosition = fmodf((float)localWritePosition - currentDelayTime + (float)delayBufferSamples, delayBufferSamples);
-        float midReadPosition  = fmodf((float)localWritePosition - (currentDelayTime - currentOffset) + (float)delayBufferSamples, delayBufferSamples);
-        float rearReadPosition = fmodf((float)localWritePosition - (currentDelayTime + currentOffset) + (float)delayBufferSamples, delayBufferSamples);
-
-
-        int frontLocalReadPosition = floorf(frontReadPosition);
-        int midLocalReadPosition = floorf(midReadPosition);
-        int rearLocalReadPosition = floorf(rearReadPosition);
-
-        if (frontLocalReadPosition != localWritePosition)
+        for (int channel = 0; channel < speakerLayout.numChannels; ++channel)
         {
-            //================================PROCESSING DELAY==========================================//
-            float frontFraction = frontReadPosition - (float)frontLocalReadPosition;
-            float midFraction   = midReadPosition - (float)midLocalReadPosition;
-            float rearFraction = rearReadPosition - (float)rearLocalReadPosition;
-
-            float delayed1L = leftdelayData[(frontLocalReadPosition + 0)];
-            float delayed1R = rightdelayData[(frontLocalReadPosition + 0)];
-            float delayed1C = centerdelayData[(frontLocalReadPosition + 0)];
-
-            float delayed2L = leftdelayData[(frontLocalReadPosition + 1) % delayBufferSamples];
-            float delayed2R = rightdelayData[(frontLocalReadPosition + 1) % delayBufferSamples];
-            float delayed2C = centerdelayData[(frontLocalReadPosition + 1) % delayBufferSamples];
-
-            float delayed3SL = surroundleftdelayData[(midLocalReadPosition + 0)];
-            float delayed3SR = surroundrightdelayData[(midLocalReadPosition + 0)];
-            float delayed4SL = surroundleftdelayData[(midLocalReadPosition + 1) % delayBufferSamples];
-            float delayed4SR = surroundrightdelayData[(midLocalReadPosition + 1) % delayBufferSamples];
-
-            float delayed5RL = rearleftdelayData[(rearLocalReadPosition + 0)];
-            float delayed5RR = rearrightdelayData[(rearLocalReadPosition + 0)];
-            float delayed5TL = topleftdelayData[(frontLocalReadPosition + 0)];
-            float delayed5TR = toprightdelayData[(frontLocalReadPosition + 0)];
-
-            float delayed6RL = rearleftdelayData[(rearLocalReadPosition + 1) % delayBufferSamples];
-            float delayed6RR = rearrightdelayData[(rearLocalReadPosition + 1) % delayBufferSamples];
-            float delayed6TL = topleftdelayData[(frontLocalReadPosition + 1) % delayBufferSamples];
-            float delayed6TR = toprightdelayData[(frontLocalReadPosition + 1) % delayBufferSamples];
-
-            leftsampleOutput            = delayed1L     + frontFraction * (delayed2L - delayed1L);
-            rightsampleOutput           = delayed1R     + frontFraction * (delayed2R - delayed1R);
-            centersampleOutput          = delayed1C     + frontFraction * (delayed2C - delayed1C);
-            surroundleftsampleOutput    = delayed3SL    + midFraction   * (delayed4SL - delayed3SL);
-            surroundrightsampleOutput   = delayed3SR    + midFraction   * (delayed4SR - delayed3SR);
-            rearleftsampleOutput        = delayed5RL    + rearFraction * (delayed6RL - delayed5RL);
-            rearrightsampleOutput       = delayed5RR    + rearFraction * (delayed6RR - delayed5RR);
-            topleftsampleOutput         = delayed5TL    + frontFraction * (delayed6TL - delayed5TL);
-            toprightsampleOutput        = delayed5TL    + frontFraction * (delayed6TL - delayed5TL);
-
-            //=========================MIX AND OUTPUT FOR CURRENT SAMPLE================================//
-            leftchannelData[sample]             = leftsampleInput   *   (1 - currentMix)      + currentMix   * (leftsampleOutput- leftsampleInput);
-            rightchannelData[sample]            = rightsampleInput  *   (1 - currentMix)      + currentMix   * (rightsampleOutput - rightsampleInput);
-            centerchannelData[sample]           =                     currentMix   * (centersampleOutput);
-            surroundleftchannelData[sample]     = leftsampleInput   + currentMix   * (surroundleftsampleOutput-leftsampleInput);
-            surroundrightchannelData[sample]    = rightsampleInput  + currentMix   * (surroundrightsampleOutput - rightsampleInput);
-            rearleftchannelData[sample]         = leftsampleInput   + currentMix   * (rearleftsampleOutput - leftsampleInput);
-            rearrightchannelData[sample]        = rightsampleInput  + currentMix   * (rearrightsampleOutput - rightsampleInput);
-            topleftchannelData[sample]          =                     currentMix   * (topleftsampleOutput);    
-            toprightchannelData[sample]         =                     currentMix   * (toprightsampleOutput);
-
-            leftdelayData[localWritePosition]           = leftsampleInput       + rightsampleOutput         * currentFeedback;
-            rightdelayData[localWritePosition]          = rightsampleInput      + leftsampleOutput          * currentFeedback;
-            centerdelayData[localWritePosition]         = centersampleInput;
-            surroundleftdelayData[localWritePosition]   = (leftsampleInput)     + surroundrightsampleOutput * currentFeedback;
-            surroundrightdelayData[localWritePosition]  = (rightsampleInput)    + surroundleftsampleOutput  * currentFeedback;
-            rearleftdelayData[localWritePosition]       = (leftsampleInput)     + rearrightsampleOutput     * currentFeedback;
-            rearrightdelayData[localWritePosition]      = (rightsampleInput)    + rearleftsampleOutput      * currentFeedback;
-            topleftdelayData[localWritePosition]        = leftsampleInput       + topleftsampleOutput       * currentFeedback;
-            toprightdelayData[localWritePosition]       = rightsampleInput      + toprightsampleOutput      * currentFeedback;
-        }
+            const auto& speaker = speakerLayout.speakers[channel];
 
-        if (++localWritePosition >= delayBufferSamples) { localWritePosition -= delayBufferSamples; }
+            if (speaker.group == SpeakerLayout::passthrough)
+                continue;
 
-    }
+            // Each speaker takes one side of the input: the front and surround pairs are crossed over,
+            // everything else takes its own side, and centred speakers take the left
+            const bool crossed = speaker.group == SpeakerLayout::front || speaker.group == SpeakerLayout::surround;
+            const bool fromRight = speaker.side != SpeakerLayout::middle && ((speaker.side == SpeakerLayout::right) != crossed);
 
-    delayWritePosition = localWritePosition;
+            const float left = fromRight ? 0.0f : inputGain;
+            const float right = fromRight ? inputGain : 0.0f;
 
-    for (int channel = getTotalNumInputChannels(); channel < getTotalNumOutputChannels(); ++channel)
-        buffer.clear(channel, 0, buffer.getNumSamples());
+            delayRouting.setChannel(channel, currentDelayTime, left, right, dry, currentMix, left, right, currentFeedback, channel);
+        }
+    }
 }
 
-void Atmos3DDelayAudioProcessor::SlapBackDelay(AudioBuffer<float>& buffer, int localWritePosition)
+void Atmos3DDelayAudioProcessor::MultiTapDelay()
 {
-    for (int channel = 0; channel < 10; ++channel)
+    bool patternMoved = false;
+
+    // Never wait for the message thread: if it is mid-update, keep the old pattern for one more block
+    if (tapPatternChanged.load())
     {
-        float* inputData;
-        if (channel != 3)
+        const SpinLock::ScopedTryLockType lock(tapPatternLock);
+
+        if (lock.isLocked())
         {
-            //Duplicate original stereo channels to multi-channel
-            if (channel == 1 || channel == 4 || channel == 7 || channel == 8)
-            {
-                // Left Channel Data
-                inputData = buffer.getWritePointer(0);
-            }
-            else if (channel == 0 || channel == 5 || channel == 6 || channel == 9)
-            {
-                // Right Channel Data
-                inputData = buffer.getWritePointer(1);
-            }
-            else 
-            {
-                // Center Channel Data
-                inputData = buffer.getWritePointer(0);
-            }
+            tapPattern = pendingTapPattern;
+            tapPatternChanged = false;
+            patternMoved = true;
+        }
+    }
 
-            float* channelData = buffer.getWritePointer(channel);
-            float* delayData = delayBuffer.getWritePointer(channel);
-            localWritePosition = delayWritePosition;
+    if (patternMoved || snapshot.hasChanged(ParameterSnapshot::delayRoutingChanged))
+        tapPattern.build(delayRouting, speakerLayout, panner, currentDelayTime, currentMix, currentFeedback);
+}
 
-            for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
-            {
-                const float in = (1/sqrt(2))*inputData[sample];
-                float out = 0.0f;
+void Atmos3DDelayAudioProcessor::FeedbackDelayNetwork()
+{
+    // The routing only depends on parameters, so keep last block's table unless one of them moved
+    if (snapshot.hasChanged(ParameterSnapshot::delayRoutingChanged))
+    {
+        // Line lengths as fractions of the Delay Time: distinct primes over the largest, so no two lines
+        // share a period, shuffled so neighbouring speakers are far apart
+        static constexpr float lengths[SpeakerLayout::maxChannels] = { 137, 97, 113, 73, 127, 89, 107, 67, 131, 83, 103, 71, 109, 79, 101, 61 };
 
-                float readPosition = fmodf((float)localWritePosition - (currentDelayTime) + (float)delayBufferSamples, delayBufferSamples);
-                int localReadPosition = floorf(readPosition);
+        delayRouting.reset(speakerLayout);
 
-                if (localReadPosition != localWritePosition)
-                {
-                    float fraction = readPosition - (float)localReadPosition;
+        for (int channel = 0; channel < speakerLayout.numChannels; ++channel)
+        {
+            const auto& speaker = speakerLayout.speakers[channel];
 
-                    float delayed1 = delayData[(localReadPosition + 0)];
-                    float delayed2 = delayData[(localReadPosition + 1) % delayBufferSamples];
-                    out = delayed1 + fraction* (delayed2 - delayed1);
+            if (speaker.group == SpeakerLayout::passthrough)
+                continue;
 
-                    channelData[sample] = in*(1-currentMix) + (currentMix * (out - in));
-                    delayData[localWritePosition] = in + out * currentFeedback;
-                }
+            // Lanes are handed out in channel order, so the tap added here is the speaker's lane
+            const float length = lengths[speaker.lane] / lengths[0];
+            const int tap = delayRouting.addTap(length * currentDelayTime, speaker.lane);
+            jassert(tap == speaker.lane);
 
-                if (++localWritePosition >= delayBufferSamples)
-                    localWritePosition -= delayBufferSamples;
-            }
+            const float dry = speaker.group == SpeakerLayout::front ? 1.0f - currentMix : 0.0f;
+            delayRouting.tapOutput[tap][speaker.lane] = 1.0f;
+            delayRouting.setOutput(channel, dry * speaker.leftWeight(), dry * speaker.rightWeight(), currentMix);
+            delayRouting.setHistoryInput(speaker.lane, speaker.leftWeight(), speaker.rightWeight());
+
+            // Shorter lines lose less per pass, so every line decays at the same rate per second
+            delayRouting.mixGain[speaker.lane] = std::pow(currentFeedback, length);
         }
+
+        delayRouting.setFeedbackMix(speakerLayout.numLanes);
     }
+}
 
-    delayWritePosition = localWritePosition;
+template <typename FloatType>
+void Atmos3DDelayAudioProcessor::processDelay(AudioBuffer<FloatType>& buffer)
+{
+    jassert(buffer.getNumChannels() >= speakerLayout.numChannels && delayLine.getNumChannels() >= speakerLayout.numLanes);
 
-    for (int channel = getTotalNumInputChannels(); channel < getTotalNumOutputChannels(); ++channel)
-        buffer.clear(channel, 0, buffer.getNumSamples());
+    const auto kernel = DelayKernel::select<FloatType>(delayLine.getFormat(), delayLine.getFrameStride(), interpolator.getNumPoints(), delayRouting.mixSize > 0);
+    kernel(delayLine, delayRouting, interpolator, buffer.getArrayOfWritePointers(), buffer.getNumSamples());
 }
 
 juce::AudioProcessorEditor* Atmos3DDelayAudioProcessor::createEditor()
@@ -568,19 +932,74 @@ juce::AudioProcessorEditor* Atmos3DDelayAudioProcessor::createEditor()
 //==============================================================================
 void Atmos3DDelayAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    auto state = parameters.copyState();
-    unique_ptr<XmlElement> xml(state.createXml());
-    copyXmlToBinary(*xml, destData);
+    SavedState state;
+
+    for (int i = 0; i < ParameterSnapshot::numParameters; ++i)
+        if (auto* value = parameters.getRawParameterValue(ParameterSnapshot::parameterIDs[i]))
+            state.values.setValue(i, value->load());
+
+    state.compactHistory = isCompactHistory();
+    state.parallelProcessing = isParallelProcessing();
+    state.bypassRingOut = isBypassRingOut();
+    state.program = currentProgram;
+    state.tapPattern = getTapPattern();
+
+    BinaryState::write(state, destData);
 }
 
 void Atmos3DDelayAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
+    SavedState state;
+
+    // Parameters a blob leaves out go back to their defaults, as they do when the XML lacks them
+    for (int i = 0; i < ParameterSnapshot::numParameters; ++i)
+        if (auto* parameter = parameters.getParameter(ParameterSnapshot::parameterIDs[i]))
+            state.values.setValue(i, parameter->convertFrom0to1(parameter->getDefaultValue()));
+
+    if (BinaryState::read(data, sizeInBytes, state))
+    {
+        setParameterScene(state.values, -1);
+        setCompactHistory(state.compactHistory);
+        setParallelProcessing(state.parallelProcessing);
+        setBypassRingOut(state.bypassRingOut);
+        currentProgram = isPositiveAndBelow(state.program, presetBank.size()) ? state.program : 0;
+        setTapPattern(state.tapPattern);
+        return;
+    }
+
+    // Sessions saved before the binary format hold the parameter tree as XML
     unique_ptr<XmlElement> xmlState(getXmlFromBinary(data, sizeInBytes));
 
     if (xmlState.get() != nullptr)
     {
-        if (xmlState->hasTagName(parameters.state.getType())) { parameters.replaceState(ValueTree::fromXml(*xmlState)); }
+        if (xmlState->hasTagName(parameters.state.getType()))
+        {
+            // Before delay_network, Multi-Tap and FDN were the fourth and fifth Delay Options; the choice
+            // parameter would clamp them to MidSide, so move them across first
+            auto tree = ValueTree::fromXml(*xmlState);
+            auto option = tree.getChildWithProperty("id", "delay_option");
+
+            if (option.isValid() && ! tree.getChildWithProperty("id", "delay_network").isValid())
+            {
+                ParameterSnapshot values;
+                values.delayOption = roundToInt((float)option.getProperty("value"));
+                BinaryState::migrateDelayOption(values);
+
+                ValueTree network("PARAM");
+                network.setProperty("id", "delay_network", nullptr);
+                network.setProperty("value", values.delayNetwork, nullptr);
+
+                option.setProperty("value", values.delayOption, nullptr);
+                tree.appendChild(network, nullptr);
+            }
+
+            parameters.replaceState(tree);
+        }
     }
+
+    // Sessions saved before the Multi-Tap mode have no pattern, and get the default one
+    const auto patternTree = parameters.state.getChildWithName(TapPattern::type);
+    setTapPattern(patternTree.isValid() ? TapPattern::fromValueTree(patternTree) : TapPattern::createDefault());
 }
 
 AudioProcessorValueTreeState::ParameterLayout Atmos3DDelayAudioProcessor::createParameters()
@@ -612,6 +1031,20 @@ AudioProcessorValueTreeState::ParameterLayout Atmos3DDelayAudioProcessor::create
     StringArray choices; choices.insert(1, "Ping-Pong"); choices.insert(2, "Normal"); choices.insert(3, "MidSide");
     parameterVector.push_back(make_unique<AudioParameterChoice>("delay_option", "Delay Options", choices, 1));
 
+    // Interpolation of the delay taps, cheapest first
+    StringArray interpolations { "Linear", "Hermite", "Lagrange", "Sinc" };
+    parameterVector.push_back(make_unique<AudioParameterChoice>("interpolation", "Interpolation", interpolations, 0));
+
+    // Damping of the repeats inside the feedback path; off at the ends of their ranges.
+    // Appended after the original parameters so their host indices stay the same
+    parameterVector.push_back(make_unique<AudioParameterFloat>("dampLowpass",           "Damping Low Pass",     1000.0f, dampLowpassOff, dampLowpassOff));
+    parameterVector.push_back(make_unique<AudioParameterFloat>("dampHighpass",          "Damping High Pass",    dampHighpassOff, 2000.0f, dampHighpassOff));
+
+    // The later modes have a parameter of their own, so adding them has not moved the normalised values of Delay Options.
+    // Anything but Off overrides Delay Options
+    StringArray networks { "Off", "Multi-Tap", "FDN" };
+    parameterVector.push_back(make_unique<AudioParameterChoice>("delay_network", "Delay Network", networks, 0));
+
     return { parameterVector.begin(), parameterVector.end() };
 }
 
@@ -9,6 +9,17 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "BinaryState.h"
+#include "DelayKernel.h"
+#include "LevelMeter.h"
+#include "MultichannelBiquad.h"
+#include "ParameterEventQueue.h"
+#include "ParameterSnapshot.h"
+#include "PresetBank.h"
+#include "SpeakerLayout.h"
+#include "TapPattern.h"
+#include "RealtimeSafety.h"
+#include "WorkerPool.h"
 
 using namespace juce;
 using namespace std;
@@ -17,7 +28,8 @@ using namespace dsp;
 //==============================================================================
 /**
 */
-class Atmos3DDelayAudioProcessor : public juce::AudioProcessor
+class Atmos3DDelayAudioProcessor : public juce::AudioProcessor,
+                                   private juce::Timer
 {
 public:
     //==============================================================================
@@ -33,22 +45,37 @@ public:
    #endif
 
     //void updateFilter();
-    void updateLowpassFilter();
-    void updateHighpassFilter();
+    void updateLowpassFilter(float cutoff);
+    void updateHighpassFilter(float cutoff);
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    void processBlockBypassed (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlockBypassed (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override;
 
-    void lpFilter(AudioBuffer<float>& buffer);
-    void hpFilter(AudioBuffer<float>& buffer);
+    // Every stage below is written once, on the host's sample type
+    template <typename FloatType> void processHostBlock(AudioBuffer<FloatType>& buffer, bool bypassed);
+    template <typename FloatType> void processChain(AudioBuffer<FloatType>& buffer);
+    template <typename FloatType> void processWithBypass(AudioBuffer<FloatType>& buffer);
+    template <typename FloatType> void filterOutput(AudioBuffer<FloatType>& buffer);
+    template <typename FloatType> void processChannelGroups(AudioBuffer<FloatType>& buffer);
+    template <typename FloatType> void processIdleBlock(AudioBuffer<FloatType>& buffer);
+    void updateIdleState(bool inputSilent, int numSamples);
+    template <typename FloatType> static bool isSilent(const AudioBuffer<FloatType>& buffer, int numChannels);
+    template <typename FloatType> static void applyGainRamp(AudioBuffer<FloatType>& tile, float blockStartGain, float blockEndGain, int tileStart, int blockLength);
 
-    // Functions of Input and Output Gain
-    void inputGainControl(AudioBuffer<float>& buffer);
-    void outputGainControl(AudioBuffer<float>& buffer);
+    // Functions of Input and Output Gain, applied to one tile of a block of blockLength samples
+    template <typename FloatType> void inputGainControl(AudioBuffer<FloatType>& tile, int tileStart, int blockLength);
+    template <typename FloatType> void outputGainControl(AudioBuffer<FloatType>& tile, int tileStart, int blockLength);
 
-    //Functions for Delay Processing
-    void MidSideDelay(AudioBuffer<float>& buffer, int localWritePosition);
-    void PingPongDelay(AudioBuffer<float>& buffer, int localWritePosition);
-    void SlapBackDelay(AudioBuffer<float>& buffer, int localWritePosition);
+    //Functions for Delay Processing: the modes set up delayRouting once per block, processDelay runs it over a tile
+    void MidSideDelay();
+    void PingPongDelay();
+    void SlapBackDelay();
+    void MultiTapDelay();
+    void FeedbackDelayNetwork();
+    template <typename FloatType> void processDelay(AudioBuffer<FloatType>& buffer);
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -74,25 +101,157 @@ public:
     void setStateInformation (const void* data, int sizeInBytes) override;
     
 
+    // Keeps the delay history as 16-bit samples, halving its memory. Saved with the state and
+    // applied at the next prepareToPlay, since the history cannot be reallocated while playing.
+    void setCompactHistory(bool shouldBeCompact);
+    bool isCompactHistory() const;
+    size_t getDelayHistoryBytes() const;
+
+    // Echoes of the Multi-Tap mode. Safe to call from the message thread while playing:
+    // the audio thread picks the new pattern up at the start of its next block.
+    void setTapPattern(const TapPattern& newPattern);
+    TapPattern getTapPattern() const;
+
+    // Splits the per-channel filter and gain work over a pool of worker threads on large layouts.
+    // Saved with the state and applied at the next prepareToPlay, which starts or stops the threads.
+    void setParallelProcessing(bool shouldBeParallel);
+    bool isParallelProcessing() const;
+    int getNumWorkerThreads() const;
+
+    // Frames each stage of processBlock handles before the next stage runs; 0 runs each stage over the whole block.
+    // Not saved with the state: it is a tuning knob for the benchmark and takes effect at the next block.
+    void setTileSize(int numFrames);
+    int getTileSize() const;
+
+    // Schedules a change to a parameter (by index, normalised) sampleOffset samples into the next block; that block is
+    // split there, so the change lands on its sample. Lock-free for one producer thread, and sample-accurate when called
+    // just before processBlock on the audio thread. Returns false if the queue is full.
+    bool queueParameterChange(int parameterIndex, float normalisedValue, int sampleOffset);
+
+    // Message thread: sets the parameters to the queued values processBlock has applied, so the host, the saved tree
+    // and the editor see them. A timer does this 30 times a second; headless tools with no message loop call it.
+    void notifyQueuedParameterChanges();
+
+    // Whether the echoes keep playing over the dry signal while the host bypasses the plugin, or fade out with it.
+    // Either way the delay keeps running, so un-bypassing carries on from a line that has decayed naturally.
+    // Saved with the state and applied at the next prepareToPlay.
+    void setBypassRingOut(bool shouldRingOut);
+    bool isBypassRingOut() const;
+
+    // True while silent input is being skipped because the echoes have died away
+    bool isIdle() const;
+
+    // How far back in samples the routing of the last block reads, as the idle check counts it: once the output has
+    // been quiet for that long, nothing audible is left in the line. Call from the thread that runs processBlock.
+    int getLongestReadDistance() const;
+
+    // Output and delay history levels, published by the audio thread after each block. One reader at a time,
+    // normally the editor's timer, takes them with LevelMeter::read without locking or waiting on the audio thread.
+    LevelMeter& getLevelMeter() noexcept;
+
     AudioProcessorValueTreeState    parameters;
     
 private:
+    void timerCallback() override;
+
 
     //User Variables
-    float                       currentDelayTime, currentMix, currentFeedback, currentBalance, currentChoice, currentOffset;
+    float                       currentDelayTime, currentMix, currentFeedback, currentBalance, currentOffset;
+    int                         currentChoice;
 
     // Variables
-    float                       startGain, finalGain, lastSampleRate{48000};
-    int                         delayBufferSamples, delayBufferChannels, delayWritePosition;
-    int                         delayBuffer0Channels, delayBuffer0Samples;
-    AudioSampleBuffer           delayBuffer;
-    AudioSampleBuffer           delayBuffer0;
+    float                       startGain{1}, finalGain{1}, lastSampleRate{48000};
+    DelayLine                   delayLine;
+    DelayRouting                delayRouting;
+    Interpolator                interpolator;
+    SpeakerLayout               speakerLayout;
+    VectorPanner                panner;
+
+    // The audio thread's copy of the tap pattern, and the one handed over by setTapPattern
+    TapPattern                  tapPattern, pendingTapPattern;
+    SpinLock                    tapPatternLock;
+    std::atomic<bool>           tapPatternChanged { false };
+
+    // Low Pass then High Pass on every channel, both in one pass over the buffer; the double
+    // one runs when the host processes in double precision
+    enum { lowpassStage, highpassStage };
+    MultichannelBiquad<float>   outputFilter;
+    MultichannelBiquad<double>  outputFilterDouble;
 
-    ProcessorDuplicator<IIR::Filter <float>, IIR::Coefficients <float>> lowPassFilter;
-    ProcessorDuplicator<IIR::Filter <float>, IIR::Coefficients <float>> highPassFilter;
+    // Cutoffs glide to new values, and coefficients follow them every filterUpdateInterval samples
+    static constexpr int        filterUpdateInterval = 32;
+    SmoothedValue<float, ValueSmoothingTypes::Multiplicative>   lowpassCutoff, highpassCutoff;
+
+    // Feedback damping: the cutoffs at which each filter is off, and the one-pole coefficients handed to the kernel
+    static constexpr float      dampLowpassOff = 20000.0f, dampHighpassOff = 20.0f;
+    float                       dampLowpassCoefficient{1}, dampHighpassCoefficient{0};
+
+    // Parameter values for the current block, refreshed once at the top of processBlock
+    ParameterCache              parameterCache;
+    ParameterSnapshot           snapshot;
+
+    // Programs, and the hand-over of whole scenes: setParameterScene makes the generation odd while it writes the
+    // parameters, and the audio thread keeps its last snapshot rather than read a mix of old and new values
+    PresetBank                  presetBank;
+    std::atomic<int>            pendingProgram { -1 };
+    std::atomic<uint32>         parameterGeneration { 0 };
+    int                         currentProgram = 0;
+
+    // Blocks shorter than this, or layouts with fewer than two groups of channelsPerGroup, stay on the audio thread
+    static constexpr int        minParallelBlockSize = 64;
+    static constexpr int        channelsPerGroup = 4;
+    WorkerPool                  workerPool;
+    int                         numChannelGroups = 1;
+    float                       groupGainStart = 1.0f, groupGainEnd = 1.0f;
+    void*                       currentGroupBuffer = nullptr;      // AudioBuffer of the sample type being processed
+
+    // Idle detection: once the input and everything written to the history have stayed under silenceThreshold
+    // for the longest read distance, blocks of silent input skip the whole chain
+    static constexpr float      silenceThreshold = 1.0e-5f;     // -100 dBFS
+    int64                       quietSamples = 0;
+    bool                        idle = false;
+
+    // Timed parameter changes, and the points processHostBlock splits the block at
+    ParameterEventQueue         parameterEvents;
+
+    LevelMeter                  levelMeter;
+
+    // Bypass crossfade, 0 running the plugin and 1 bypassed, and the input kept to fade in as the bypassed signal
+    SmoothedValue<float>        bypassFade;
+    AudioBuffer<float>          bypassDryBuffer;
+    AudioBuffer<double>         bypassDryBufferDouble;
+    bool                        bypassRingOut = false;
+
+    // processBlock tile: 64 frames of 16 channels is 4 KiB, which stays in L1 across every stage
+    int                         tileSize = 64;
+
+    static inline const Identifier compactHistoryProperty { "compactHistory" };
+    static inline const Identifier parallelProcessingProperty { "parallelProcessing" };
+    static inline const Identifier bypassRingOutProperty { "bypassRingOut" };
 
     // Functions
     AudioProcessorValueTreeState::ParameterLayout createParameters();
+    void refreshParameters() noexcept;
+    void setParameterScene(const ParameterSnapshot& values, int program);
+    template <typename FloatType> static void processChannelGroup(void* processor, int group) noexcept;
+
+    template <typename FloatType>
+    MultichannelBiquad<FloatType>& getOutputFilter() noexcept
+    {
+        if constexpr (std::is_same<FloatType, double>::value)
+            return outputFilterDouble;
+        else
+            return outputFilter;
+    }
+
+    template <typename FloatType>
+    AudioBuffer<FloatType>& getBypassDryBuffer() noexcept
+    {
+        if constexpr (std::is_same<FloatType, double>::value)
+            return bypassDryBufferDouble;
+        else
+            return bypassDryBuffer;
+    }
 
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Atmos3DDelayAudioProcessor)
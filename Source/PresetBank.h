@@ -0,0 +1,176 @@
+/*
+  ==============================================================================
+
+    PresetBank.h
+    Factory programs, each a complete scene ready to hand to the audio thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ParameterSnapshot.h"
+#include "TapPattern.h"
+
+using namespace juce;
+
+//==============================================================================
+/** One program: every parameter and the Multi-Tap pattern. */
+struct Preset
+{
+    String              name;
+    ParameterSnapshot   values;
+    TapPattern          tapPattern = TapPattern::createDefault();
+};
+
+//==============================================================================
+/**
+    The programs the host lists. They are built once, with the processor, and
+    never change afterwards, so the audio thread can copy a program's snapshot
+    and pattern straight out of the bank with no lock and no lookups.
+
+    prepare() rounds every value through its parameter, so a program taken by
+    the audio thread matches the parameter tree exactly and the next refresh
+    of the snapshot sees nothing to change.
+*/
+class PresetBank
+{
+public:
+    enum DelayMode { pingPong, normal, midSide, multiTap, feedbackNetwork };
+
+    PresetBank()
+    {
+        add("Default");
+
+        {
+            auto& preset = add("Wide Ping-Pong");
+            preset.values.setDelayMode(pingPong);
+            preset.values.delayTime     = 0.375f;
+            preset.values.mix           = 0.35f;
+            preset.values.feedback      = 0.55f;
+            preset.values.balance       = 0.8f;
+            preset.values.offset        = 0.01f;
+            preset.values.lowpass       = 9000.0f;
+            preset.values.highpass      = 150.0f;
+        }
+
+        {
+            auto& preset = add("Slapback Room");
+            preset.values.setDelayMode(normal);
+            preset.values.delayTime     = 0.09f;
+            preset.values.mix           = 0.3f;
+            preset.values.feedback      = 0.15f;
+            preset.values.lowpass       = 7000.0f;
+            preset.values.highpass      = 120.0f;
+        }
+
+        {
+            auto& preset = add("Mid/Side Space");
+            preset.values.setDelayMode(midSide);
+            preset.values.delayTime     = 0.5f;
+            preset.values.mix           = 0.4f;
+            preset.values.feedback      = 0.45f;
+            preset.values.offset        = 0.03f;
+            preset.values.lowpass       = 12000.0f;
+            preset.values.highpass      = 100.0f;
+            preset.values.dampLowpass   = 6000.0f;
+        }
+
+        {
+            auto& preset = add("Spiral Taps");
+            preset.values.setDelayMode(multiTap);
+            preset.values.delayTime     = 1.5f;
+            preset.values.mix           = 0.45f;
+            preset.values.feedback      = 0.4f;
+            preset.values.lowpass       = 14000.0f;
+            preset.values.highpass      = 80.0f;
+        }
+
+        {
+            // Six echoes falling from overhead towards the floor, alternating sides
+            auto& preset = add("Overhead Rain");
+            preset.values.setDelayMode(multiTap);
+            preset.values.delayTime     = 1.0f;
+            preset.values.mix           = 0.4f;
+            preset.values.feedback      = 0.3f;
+            preset.values.lowpass       = 12000.0f;
+            preset.values.highpass      = 200.0f;
+            preset.tapPattern           = {};
+
+            for (int i = 0; i < 6; ++i)
+            {
+                EchoTap tap;
+                tap.time        = (float)(i + 1) / 6.0f;
+                tap.gain        = std::pow(0.75f, (float)i);
+                tap.feedback    = i == 5 ? 1.0f : 0.0f;
+                tap.azimuth     = (i % 2 == 0 ? 1.0f : -1.0f) * (30.0f + 20.0f * (float)i);
+                tap.elevation   = 70.0f - 12.0f * (float)i;
+                preset.tapPattern.addTap(tap);
+            }
+        }
+
+        {
+            auto& preset = add("Dense Hall");
+            preset.values.setDelayMode(feedbackNetwork);
+            preset.values.delayTime     = 0.12f;
+            preset.values.mix           = 0.35f;
+            preset.values.feedback      = 0.8f;
+            preset.values.lowpass       = 10000.0f;
+            preset.values.highpass      = 100.0f;
+            preset.values.dampLowpass   = 5000.0f;
+            preset.values.dampHighpass  = 120.0f;
+            preset.values.interpolation = 1;
+        }
+
+        {
+            auto& preset = add("Dark Repeats");
+            preset.values.setDelayMode(normal);
+            preset.values.delayTime     = 0.6f;
+            preset.values.mix           = 0.35f;
+            preset.values.feedback      = 0.7f;
+            preset.values.lowpass       = 6000.0f;
+            preset.values.highpass      = 100.0f;
+            preset.values.dampLowpass   = 2500.0f;
+            preset.values.dampHighpass  = 200.0f;
+        }
+    }
+
+    /** Rounds every program's values the way the parameters will store them. Call once, before any program is used. */
+    void prepare(const AudioProcessorValueTreeState& parameters)
+    {
+        for (int i = 0; i < numPresets; ++i)
+        {
+            for (int index = 0; index < ParameterSnapshot::numParameters; ++index)
+            {
+                if (auto* parameter = parameters.getParameter(ParameterSnapshot::parameterIDs[index]))
+                {
+                    const float value = presets[i].values.getValue(index);
+                    presets[i].values.setValue(index, parameter->convertFrom0to1(parameter->convertTo0to1(value)));
+                }
+            }
+
+            presets[i].values.markAllChanged();
+        }
+    }
+
+    int size() const noexcept                           { return numPresets; }
+    const Preset& operator[](int index) const noexcept  { jassert(isPositiveAndBelow(index, numPresets)); return presets[index]; }
+
+private:
+    static constexpr int maxPresets = 16;
+
+    Preset  presets[maxPresets];
+    int     numPresets = 0;
+
+    Preset& add(const String& name)
+    {
+        jassert(numPresets < maxPresets);
+
+        auto& preset = presets[numPresets++];
+        preset.name = name;
+        return preset;
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PresetBank)
+};
@@ -0,0 +1,344 @@
+/*
+  ==============================================================================
+
+    RealtimeSafety.cpp
+    Counting replacements for operator new/delete, and on Linux for the common
+    blocking and system calls, active only inside a ScopedAudioThread.
+
+  ==============================================================================
+*/
+
+// The fortified inline wrappers for read/write/open would clash with the interposers below
+#undef _FORTIFY_SOURCE
+
+#include "RealtimeSafety.h"
+
+#if ATMOS_REALTIME_CHECKS
+
+#include <new>
+#include <cstdlib>
+
+#if JUCE_LINUX || JUCE_MAC
+ #include <dlfcn.h>
+#endif
+
+#if JUCE_LINUX && ATMOS_REALTIME_INTERPOSE
+ #include <pthread.h>
+ #include <sched.h>
+ #include <semaphore.h>
+ #include <sys/syscall.h>
+ #include <fcntl.h>
+ #include <unistd.h>
+ #include <time.h>
+ #include <cstdarg>
+#endif
+
+#if JUCE_MSVC
+ #include <intrin.h>
+ #define ATMOS_CALLER _ReturnAddress()
+#else
+ #define ATMOS_CALLER __builtin_return_address (0)
+#endif
+
+namespace RealtimeSafety
+{
+    namespace
+    {
+        // Only trivially constructed globals here: all of this runs inside operator new and lock calls
+        std::atomic<uint64>         counts[numEvents];
+        std::atomic<int>            numRecorded { 0 };
+        Violation                   recorded[Report::maxViolations];
+        std::atomic<bool>           hasTrapped { false };
+
+        thread_local int            depth = 0;
+        thread_local const char*    currentScope = nullptr;
+
+        uint64 currentTotal() noexcept
+        {
+            uint64 total = 0;
+
+            for (auto& count : counts)
+                total += count.load(std::memory_order_relaxed);
+
+            return total;
+        }
+
+        String describeAddress(const void* address)
+        {
+           #if JUCE_LINUX || JUCE_MAC
+            Dl_info info;
+
+            if (dladdr(address, &info) != 0 && info.dli_sname != nullptr)
+                return String(info.dli_sname) + " + 0x" + String::toHexString((pointer_sized_int)address - (pointer_sized_int)info.dli_saddr);
+           #endif
+
+            return "0x" + String::toHexString((pointer_sized_int)address);
+        }
+    }
+
+    uint64 Report::getTotal() const noexcept
+    {
+        uint64 total = 0;
+
+        for (auto count : counts)
+            total += count;
+
+        return total;
+    }
+
+    ScopedAudioThread::ScopedAudioThread(const char* scopeName) noexcept
+        : previousScope(currentScope), totalOnEntry(currentTotal())
+    {
+        currentScope = scopeName;
+        ++depth;
+    }
+
+    ScopedAudioThread::~ScopedAudioThread() noexcept
+    {
+        --depth;
+        currentScope = previousScope;
+
+        // Stop in the debugger the first time an audio scope does something it must not.
+        // Use getReport() / describe() to see what it was.
+        if (depth == 0 && currentTotal() != totalOnEntry && ! hasTrapped.exchange(true))
+            jassertfalse;
+    }
+
+    void record(Event event, const char* function, const void* caller) noexcept
+    {
+        if (depth == 0)
+            return;
+
+        counts[event].fetch_add(1, std::memory_order_relaxed);
+
+        // Keep one entry per call site
+        const int numKnown = jmin(numRecorded.load(std::memory_order_relaxed), Report::maxViolations);
+
+        for (int i = 0; i < numKnown; ++i)
+            if (recorded[i].caller == caller && recorded[i].event == event)
+                return;
+
+        const int index = numRecorded.fetch_add(1, std::memory_order_relaxed);
+
+        if (index < Report::maxViolations)
+            recorded[index] = { event, function, caller, currentScope };
+    }
+
+    Report getReport() noexcept
+    {
+        Report report;
+
+        for (int event = 0; event < numEvents; ++event)
+            report.counts[event] = counts[event].load(std::memory_order_relaxed);
+
+        report.numViolations = jmin(numRecorded.load(std::memory_order_relaxed), Report::maxViolations);
+
+        for (int i = 0; i < report.numViolations; ++i)
+            report.violations[i] = recorded[i];
+
+        return report;
+    }
+
+    void resetReport() noexcept
+    {
+        for (auto& count : counts)
+            count.store(0, std::memory_order_relaxed);
+
+        numRecorded.store(0, std::memory_order_relaxed);
+    }
+
+    String describe(const Report& report)
+    {
+        static const char* const eventNames[numEvents] = { "allocation", "deallocation", "lock", "system call" };
+
+        String text;
+
+        for (int event = 0; event < numEvents; ++event)
+            text << eventNames[event] << "s: " << (int64)report.counts[event] << newLine;
+
+        for (int i = 0; i < report.numViolations; ++i)
+        {
+            const auto& violation = report.violations[i];
+
+            text << eventNames[violation.event] << " in " << (violation.scope != nullptr ? violation.scope : "?")
+                 << ": " << violation.function << " called from " << describeAddress(violation.caller) << newLine;
+        }
+
+        return text;
+    }
+}
+
+//==============================================================================
+namespace
+{
+    void* allocate(std::size_t size, const void* caller) noexcept
+    {
+        RealtimeSafety::record(RealtimeSafety::allocation, "operator new", caller);
+        return std::malloc(size != 0 ? size : 1);
+    }
+
+    void* allocateAligned(std::size_t size, std::align_val_t alignment, const void* caller) noexcept
+    {
+        RealtimeSafety::record(RealtimeSafety::allocation, "operator new", caller);
+
+       #if JUCE_WINDOWS
+        return _aligned_malloc(size != 0 ? size : 1, (size_t)alignment);
+       #else
+        void* memory = nullptr;
+        return posix_memalign(&memory, jmax((size_t)alignment, sizeof(void*)), size != 0 ? size : 1) == 0 ? memory : nullptr;
+       #endif
+    }
+
+    void deallocate(void* memory, const void* caller) noexcept
+    {
+        if (memory != nullptr)
+            RealtimeSafety::record(RealtimeSafety::deallocation, "operator delete", caller);
+
+        std::free(memory);
+    }
+
+    void deallocateAligned(void* memory, const void* caller) noexcept
+    {
+        if (memory != nullptr)
+            RealtimeSafety::record(RealtimeSafety::deallocation, "operator delete", caller);
+
+       #if JUCE_WINDOWS
+        _aligned_free(memory);
+       #else
+        std::free(memory);
+       #endif
+    }
+
+    template <typename Result>
+    Result* throwIfNull(Result* memory)
+    {
+        if (memory == nullptr)
+            throw std::bad_alloc();
+
+        return memory;
+    }
+}
+
+void* operator new (std::size_t size)                                           { return throwIfNull(allocate(size, ATMOS_CALLER)); }
+void* operator new[] (std::size_t size)                                         { return throwIfNull(allocate(size, ATMOS_CALLER)); }
+void* operator new (std::size_t size, const std::nothrow_t&) noexcept           { return allocate(size, ATMOS_CALLER); }
+void* operator new[] (std::size_t size, const std::nothrow_t&) noexcept         { return allocate(size, ATMOS_CALLER); }
+void* operator new (std::size_t size, std::align_val_t alignment)               { return throwIfNull(allocateAligned(size, alignment, ATMOS_CALLER)); }
+void* operator new[] (std::size_t size, std::align_val_t alignment)             { return throwIfNull(allocateAligned(size, alignment, ATMOS_CALLER)); }
+void* operator new (std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept   { return allocateAligned(size, alignment, ATMOS_CALLER); }
+void* operator new[] (std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return allocateAligned(size, alignment, ATMOS_CALLER); }
+
+void operator delete (void* memory) noexcept                                    { deallocate(memory, ATMOS_CALLER); }
+void operator delete[] (void* memory) noexcept                                  { deallocate(memory, ATMOS_CALLER); }
+void operator delete (void* memory, std::size_t) noexcept                       { deallocate(memory, ATMOS_CALLER); }
+void operator delete[] (void* memory, std::size_t) noexcept                     { deallocate(memory, ATMOS_CALLER); }
+void operator delete (void* memory, const std::nothrow_t&) noexcept             { deallocate(memory, ATMOS_CALLER); }
+void operator delete[] (void* memory, const std::nothrow_t&) noexcept           { deallocate(memory, ATMOS_CALLER); }
+void operator delete (void* memory, std::align_val_t) noexcept                  { deallocateAligned(memory, ATMOS_CALLER); }
+void operator delete[] (void* memory, std::align_val_t) noexcept                { deallocateAligned(memory, ATMOS_CALLER); }
+void operator delete (void* memory, std::size_t, std::align_val_t) noexcept     { deallocateAligned(memory, ATMOS_CALLER); }
+void operator delete[] (void* memory, std::size_t, std::align_val_t) noexcept   { deallocateAligned(memory, ATMOS_CALLER); }
+void operator delete (void* memory, std::align_val_t, const std::nothrow_t&) noexcept   { deallocateAligned(memory, ATMOS_CALLER); }
+void operator delete[] (void* memory, std::align_val_t, const std::nothrow_t&) noexcept { deallocateAligned(memory, ATMOS_CALLER); }
+
+//==============================================================================
+#if JUCE_LINUX && ATMOS_REALTIME_INTERPOSE
+namespace
+{
+    // Looked up lazily without a function-local static guard, which could itself take a lock
+    template <typename Function>
+    Function nextSymbol(std::atomic<void*>& cache, const char* name) noexcept
+    {
+        void* symbol = cache.load(std::memory_order_relaxed);
+
+        if (symbol == nullptr)
+        {
+            symbol = dlsym(RTLD_NEXT, name);
+            cache.store(symbol, std::memory_order_relaxed);
+        }
+
+        return reinterpret_cast<Function>(symbol);
+    }
+}
+
+#define ATMOS_INTERPOSE(event, returnType, name, parameters, arguments, specifier)     \
+    extern "C" returnType name parameters specifier                                     \
+    {                                                                                   \
+        RealtimeSafety::record(RealtimeSafety::event, #name, ATMOS_CALLER);             \
+        static std::atomic<void*> next { nullptr };                                     \
+        return nextSymbol<returnType (*) parameters>(next, #name) arguments;            \
+    }
+
+ATMOS_INTERPOSE(lock,       int,     pthread_mutex_lock,     (pthread_mutex_t* mutex),                           (mutex),                    noexcept)
+ATMOS_INTERPOSE(lock,       int,     pthread_rwlock_rdlock,  (pthread_rwlock_t* rwlock),                         (rwlock),                   noexcept)
+ATMOS_INTERPOSE(lock,       int,     pthread_rwlock_wrlock,  (pthread_rwlock_t* rwlock),                         (rwlock),                   noexcept)
+ATMOS_INTERPOSE(lock,       int,     sem_wait,               (sem_t* semaphore),                                 (semaphore),                )
+ATMOS_INTERPOSE(lock,       int,     pthread_cond_wait,      (pthread_cond_t* condition, pthread_mutex_t* mutex), (condition, mutex),        )
+ATMOS_INTERPOSE(lock,       int,     pthread_cond_timedwait, (pthread_cond_t* condition, pthread_mutex_t* mutex, const struct timespec* time), (condition, mutex, time), )
+ATMOS_INTERPOSE(systemCall, int,     pthread_cond_signal,    (pthread_cond_t* condition),                        (condition),                noexcept)
+ATMOS_INTERPOSE(systemCall, int,     pthread_cond_broadcast, (pthread_cond_t* condition),                        (condition),                noexcept)
+ATMOS_INTERPOSE(systemCall, int,     sched_yield,            (),                                                 (),                         noexcept)
+ATMOS_INTERPOSE(systemCall, ssize_t, read,                   (int fd, void* data, size_t size),                  (fd, data, size),           )
+ATMOS_INTERPOSE(systemCall, ssize_t, write,                  (int fd, const void* data, size_t size),            (fd, data, size),           )
+ATMOS_INTERPOSE(systemCall, int,     close,                  (int fd),                                           (fd),                       )
+ATMOS_INTERPOSE(systemCall, int,     nanosleep,              (const struct timespec* duration, struct timespec* remaining), (duration, remaining), )
+ATMOS_INTERPOSE(systemCall, int,     usleep,                 (useconds_t microseconds),                          (microseconds),             )
+
+// open and open64 only take a mode when creating; syscall passes up to six register-sized arguments,
+// so futex waits and wakes made without libc's wrappers are caught too
+#define ATMOS_INTERPOSE_OPEN(name)                                                              \
+    extern "C" int name(const char* path, int flags, ...)                                       \
+    {                                                                                           \
+        RealtimeSafety::record(RealtimeSafety::systemCall, #name, ATMOS_CALLER);                \
+                                                                                                \
+        mode_t mode = 0;                                                                        \
+                                                                                                \
+        if ((flags & O_CREAT) != 0)                                                             \
+        {                                                                                       \
+            va_list args;                                                                       \
+            va_start(args, flags);                                                              \
+            mode = (mode_t)va_arg(args, int);                                                   \
+            va_end(args);                                                                       \
+        }                                                                                       \
+                                                                                                \
+        static std::atomic<void*> next { nullptr };                                             \
+        return nextSymbol<int (*) (const char*, int, ...)>(next, #name)(path, flags, mode);     \
+    }
+
+ATMOS_INTERPOSE_OPEN(open)
+ATMOS_INTERPOSE_OPEN(open64)
+
+extern "C" long syscall(long number, ...) noexcept
+{
+    RealtimeSafety::record(RealtimeSafety::systemCall, number == SYS_futex ? "syscall(SYS_futex)" : "syscall", ATMOS_CALLER);
+
+    long arguments[6];
+    va_list args;
+    va_start(args, number);
+
+    for (auto& argument : arguments)
+        argument = va_arg(args, long);
+
+    va_end(args);
+
+    static std::atomic<void*> next { nullptr };
+    return nextSymbol<long (*) (long, ...)>(next, "syscall")(number, arguments[0], arguments[1], arguments[2],
+                                                             arguments[3], arguments[4], arguments[5]);
+}
+#endif
+
+#else
+
+// Stubs so callers do not need their own #if around reporting
+namespace RealtimeSafety
+{
+    uint64 Report::getTotal() const noexcept                 { return 0; }
+    ScopedAudioThread::ScopedAudioThread(const char*) noexcept : previousScope(nullptr), totalOnEntry(0) {}
+    ScopedAudioThread::~ScopedAudioThread() noexcept         {}
+    void record(Event, const char*, const void*) noexcept    {}
+    Report getReport() noexcept                              { return {}; }
+    void resetReport() noexcept                              {}
+    String describe(const Report&)                           { return "real-time checks are disabled (build with ATMOS_REALTIME_CHECKS=1)"; }
+}
+
+#endif
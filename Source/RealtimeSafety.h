@@ -0,0 +1,101 @@
+/*
+  ==============================================================================
+
+    RealtimeSafety.h
+    Debug/profiling checks for work that must never happen on the audio thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+using namespace juce;
+
+// Build with ATMOS_REALTIME_CHECKS=1 to count operator new/delete, lock and
+// system calls made inside ATMOS_REALTIME_SCOPE. Allocations are caught on every
+// platform. Locks and system calls are interposed on Linux only, and only with
+// ATMOS_REALTIME_INTERPOSE=1, which the CMake tools set: a plugin binary must not
+// replace pthread_mutex_lock for the whole host process. There is deliberately no way
+// to exempt a call: product code that must block belongs outside the audio scope.
+#ifndef ATMOS_REALTIME_CHECKS
+ #define ATMOS_REALTIME_CHECKS 0
+#endif
+
+#ifndef ATMOS_REALTIME_INTERPOSE
+ #define ATMOS_REALTIME_INTERPOSE 0
+#endif
+
+// The replacement operator new/delete is global, so inside a plugin it would count the host's own allocations too.
+// Plugin builds need ATMOS_REALTIME_CHECKS_IN_PLUGIN=1 as well, to make that a deliberate choice; never interpose there.
+#if ATMOS_REALTIME_CHECKS && (JucePlugin_Build_VST || JucePlugin_Build_VST3 || JucePlugin_Build_AU || JucePlugin_Build_AUv3 \
+                              || JucePlugin_Build_AAX || JucePlugin_Build_LV2 || JucePlugin_Build_Standalone)
+ #if ! ATMOS_REALTIME_CHECKS_IN_PLUGIN
+  #error "ATMOS_REALTIME_CHECKS is meant for the CMake tools; define ATMOS_REALTIME_CHECKS_IN_PLUGIN=1 to use it in a plugin build"
+ #endif
+ #if ATMOS_REALTIME_INTERPOSE
+  #error "ATMOS_REALTIME_INTERPOSE would replace the host's libc and pthread symbols"
+ #endif
+#endif
+
+namespace RealtimeSafety
+{
+    enum Event
+    {
+        allocation,
+        deallocation,
+        lock,
+        systemCall,
+        numEvents
+    };
+
+    /** One offending call: what was called, from where, and inside which scope. */
+    struct Violation
+    {
+        Event           event;
+        const char*     function;
+        const void*     caller;
+        const char*     scope;
+    };
+
+    struct Report
+    {
+        static constexpr int maxViolations = 32;
+
+        uint64      counts[numEvents] {};
+        int         numViolations = 0;                  // Call sites recorded, up to maxViolations
+        Violation   violations[maxViolations] {};
+
+        uint64 getTotal() const noexcept;
+    };
+
+    /** Marks the calling thread as real-time while in scope. Scopes may nest. */
+    class ScopedAudioThread
+    {
+    public:
+        explicit ScopedAudioThread(const char* scopeName) noexcept;
+        ~ScopedAudioThread() noexcept;
+
+    private:
+        const char* previousScope;
+        uint64      totalOnEntry;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedAudioThread)
+    };
+
+    /** Called by the interposed functions, and by code that knowingly blocks; does nothing outside a ScopedAudioThread. */
+    void record(Event event, const char* function, const void* caller) noexcept;
+
+    Report getReport() noexcept;
+    void resetReport() noexcept;
+
+    /** Readable summary with one line per recorded call site. Allocates, so never call it from the audio thread. */
+    String describe(const Report& report);
+}
+
+#if ATMOS_REALTIME_CHECKS
+ #define ATMOS_REALTIME_SCOPE(name)   RealtimeSafety::ScopedAudioThread realtimeSafetyScope (name)
+#else
+ #define ATMOS_REALTIME_SCOPE(name)
+#endif
@@ -0,0 +1,185 @@
+/*
+  ==============================================================================
+
+    SpeakerLayout.h
+    Maps the channels of the current bus layout to the roles the delay modes use.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+using namespace juce;
+
+//==============================================================================
+/**
+    Built in prepareToPlay from the host's bus layout, so the delay modes can be
+    written in terms of speaker groups instead of 7.1.2 channel indices.
+
+    Groups follow the names the modes already used for 7.1.2: "rear" is the
+    pair straight after the LFE (side or 5.1 surrounds, plus wides), "surround"
+    is the back pair. LFE and anything that is not a speaker position are
+    passed through untouched, and get no lane in the delay history: every
+    other speaker is given the next free lane, so history frames only hold
+    the channels that are actually delayed.
+*/
+struct SpeakerLayout
+{
+    enum Group { front, centre, rear, surround, top, passthrough };
+    enum Side { left, right, middle };
+
+    struct Speaker
+    {
+        Group   group = passthrough;
+        Side    side = middle;
+        int     partner = 0;                                    // Mirror-image channel on the other side, or itself
+        int     lane = -1;                                      // Position in a delay history frame, or -1 for passthrough
+        float   azimuth = 0.0f, elevation = 0.0f;               // Nominal direction in degrees, azimuth positive to the left
+        float   x = 1.0f, y = 0.0f, z = 0.0f;                   // The same direction as a unit vector: x front, y left, z up
+
+        float leftWeight() const noexcept   { return side == left ? 1.0f : (side == right ? 0.0f : 0.5f); }
+        float rightWeight() const noexcept  { return side == right ? 1.0f : (side == left ? 0.0f : 0.5f); }
+    };
+
+    static constexpr int maxChannels = 16;
+
+    int         numChannels = 0;
+    int         numLanes = 0;
+    int         inputLeft = 0, inputRight = 1;                  // Where the stereo source sits in the input bus
+    Speaker     speakers[maxChannels];
+
+    static bool isSupported(const AudioChannelSet& output)
+    {
+        return ! output.isDisabled()
+            && output.size() <= maxChannels
+            && output.getAmbisonicOrder() < 0
+            && output.getChannelIndexForType(AudioChannelSet::left) >= 0
+            && output.getChannelIndexForType(AudioChannelSet::right) >= 0;
+    }
+
+    void build(const AudioChannelSet& output, const AudioChannelSet& input)
+    {
+        jassert(isSupported(output));
+
+        numChannels = jmin(output.size(), maxChannels);
+        numLanes = 0;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            const auto type = output.getTypeOfChannel(channel);
+            const auto& position = getPosition(type);
+            const int partner = output.getChannelIndexForType(getMirror(type));
+
+            auto& speaker = speakers[channel];
+            speaker = { position.group, position.side, isPositiveAndBelow(partner, numChannels) ? partner : channel,
+                        position.group != passthrough ? numLanes++ : -1, position.azimuth, position.elevation };
+
+            toUnitVector(speaker.azimuth, speaker.elevation, speaker.x, speaker.y, speaker.z);
+        }
+
+        // A mono input feeds both sides
+        inputLeft = jmax(0, input.getChannelIndexForType(input.size() == 1 ? input.getTypeOfChannel(0) : AudioChannelSet::left));
+        inputRight = input.size() == 1 ? inputLeft : jmax(0, input.getChannelIndexForType(AudioChannelSet::right));
+    }
+
+    /** Layouts the command-line tools accept by name, e.g. "7.1.2"; anything else is disabled(). */
+    static AudioChannelSet getLayoutForName(const String& name)
+    {
+        if (name == "5.1")      return AudioChannelSet::create5point1();
+        if (name == "5.1.2")    return AudioChannelSet::create5point1point2();
+        if (name == "5.1.4")    return AudioChannelSet::create5point1point4();
+        if (name == "7.1")      return AudioChannelSet::create7point1();
+        if (name == "7.1.2")    return AudioChannelSet::create7point1point2();
+        if (name == "7.1.4")    return AudioChannelSet::create7point1point4();
+        if (name == "9.1.6")    return AudioChannelSet::create9point1point6();
+
+        return AudioChannelSet::disabled();
+    }
+
+    static void toUnitVector(float azimuth, float elevation, float& x, float& y, float& z) noexcept
+    {
+        const float a = degreesToRadians(azimuth), e = degreesToRadians(elevation);
+        x = std::cos(a) * std::cos(e);
+        y = std::sin(a) * std::cos(e);
+        z = std::sin(e);
+    }
+
+private:
+    /** Group, side and nominal direction of a speaker type. */
+    struct Position
+    {
+        AudioChannelSet::ChannelType    type;
+        Group                           group;
+        Side                            side;
+        float                           azimuth, elevation;
+    };
+
+    // Angles as laid out in ITU-R BS.775 and the Dolby Atmos home speaker guides. A table rather than a switch, so the
+    // types it leaves out (LFE, discrete channels and the like) do not each need a case; they are passed through
+    static const Position& getPosition(AudioChannelSet::ChannelType type) noexcept
+    {
+        static constexpr Position positions[] =
+        {
+            { AudioChannelSet::left,                front,      left,       30.0f,      0.0f },
+            { AudioChannelSet::right,               front,      right,      -30.0f,     0.0f },
+            { AudioChannelSet::leftCentre,          front,      left,       15.0f,      0.0f },
+            { AudioChannelSet::rightCentre,         front,      right,      -15.0f,     0.0f },
+            { AudioChannelSet::centre,              centre,     middle,     0.0f,       0.0f },
+
+            { AudioChannelSet::wideLeft,            rear,       left,       60.0f,      0.0f },
+            { AudioChannelSet::wideRight,           rear,       right,      -60.0f,     0.0f },
+            { AudioChannelSet::leftSurroundSide,    rear,       left,       90.0f,      0.0f },
+            { AudioChannelSet::rightSurroundSide,   rear,       right,      -90.0f,     0.0f },
+            { AudioChannelSet::leftSurround,        rear,       left,       110.0f,     0.0f },
+            { AudioChannelSet::rightSurround,       rear,       right,      -110.0f,    0.0f },
+
+            { AudioChannelSet::leftSurroundRear,    surround,   left,       150.0f,     0.0f },
+            { AudioChannelSet::rightSurroundRear,   surround,   right,      -150.0f,    0.0f },
+            { AudioChannelSet::centreSurround,      surround,   middle,     180.0f,     0.0f },
+
+            { AudioChannelSet::topFrontLeft,        top,        left,       45.0f,      45.0f },
+            { AudioChannelSet::topFrontCentre,      top,        middle,     0.0f,       45.0f },
+            { AudioChannelSet::topFrontRight,       top,        right,      -45.0f,     45.0f },
+            { AudioChannelSet::topSideLeft,         top,        left,       90.0f,      45.0f },
+            { AudioChannelSet::topSideRight,        top,        right,      -90.0f,     45.0f },
+            { AudioChannelSet::topRearLeft,         top,        left,       135.0f,     45.0f },
+            { AudioChannelSet::topRearCentre,       top,        middle,     180.0f,     45.0f },
+            { AudioChannelSet::topRearRight,        top,        right,      -135.0f,    45.0f },
+            { AudioChannelSet::topMiddle,           top,        middle,     0.0f,       90.0f }
+        };
+
+        static constexpr Position unlisted { AudioChannelSet::unknown, passthrough, middle, 0.0f, 0.0f };
+
+        for (auto& position : positions)
+            if (position.type == type)
+                return position;
+
+        return unlisted;
+    }
+
+    static AudioChannelSet::ChannelType getMirror(AudioChannelSet::ChannelType type) noexcept
+    {
+        static constexpr AudioChannelSet::ChannelType pairs[][2] =
+        {
+            { AudioChannelSet::left,                AudioChannelSet::right },
+            { AudioChannelSet::leftCentre,          AudioChannelSet::rightCentre },
+            { AudioChannelSet::leftSurround,        AudioChannelSet::rightSurround },
+            { AudioChannelSet::leftSurroundSide,    AudioChannelSet::rightSurroundSide },
+            { AudioChannelSet::leftSurroundRear,    AudioChannelSet::rightSurroundRear },
+            { AudioChannelSet::wideLeft,            AudioChannelSet::wideRight },
+            { AudioChannelSet::topFrontLeft,        AudioChannelSet::topFrontRight },
+            { AudioChannelSet::topRearLeft,         AudioChannelSet::topRearRight },
+            { AudioChannelSet::topSideLeft,         AudioChannelSet::topSideRight }
+        };
+
+        for (auto& pair : pairs)
+        {
+            if (pair[0] == type) return pair[1];
+            if (pair[1] == type) return pair[0];
+        }
+
+        return type;
+    }
+};
@@ -0,0 +1,53 @@
+/*
+  ==============================================================================
+
+    StaticLayer.h
+    A component's unchanging drawing, cached in an image at the display's scale.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+using namespace juce;
+
+//==============================================================================
+/**
+    Holds what a component draws the same way every frame, so paint() can blit
+    it instead of drawing it again. The image has as many pixels as the display
+    gives the component, so it stays sharp on high-density screens; render()
+    again when the size, the scale or the content changes.
+*/
+class StaticLayer
+{
+public:
+    StaticLayer() = default;
+
+    /** Renders draw(g) in the component's own coordinates. Does nothing while the component has no size. */
+    template <typename DrawFunction>
+    void render(Component& component, DrawFunction&& draw)
+    {
+        if (component.getWidth() <= 0 || component.getHeight() <= 0)
+            return;
+
+        const float scale = Component::getApproximateScaleFactorForComponent(&component);
+        image = Image(Image::RGB, roundToInt((float)component.getWidth() * scale), roundToInt((float)component.getHeight() * scale), true);
+
+        Graphics g(image);
+        g.addTransform(AffineTransform::scale(scale));
+        draw(g);
+    }
+
+    /** Blits the layer over the whole component. */
+    void draw(Graphics& g, const Component& component) const
+    {
+        g.drawImage(image, component.getLocalBounds().toFloat());
+    }
+
+private:
+    Image image;
+
+    JUCE_DECLARE_NON_COPYABLE (StaticLayer)
+};
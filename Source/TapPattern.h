@@ -0,0 +1,186 @@
+/*
+  ==============================================================================
+
+    TapPattern.h
+    Echo taps of the Multi-Tap mode, each with its own time, level and position.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "DelayKernel.h"
+#include "VectorPanner.h"
+
+//==============================================================================
+/** One echo of a TapPattern. */
+struct EchoTap
+{
+    float   time = 1.0f;            // Fraction of the Delay Time parameter
+    float   gain = 1.0f;
+    float   feedback = 0.0f;        // Share of this echo fed back into the line, scaled by the Feedback parameter
+    float   azimuth = 0.0f;         // Degrees, 0 = front, positive to the left
+    float   elevation = 0.0f;       // Degrees above the listener
+};
+
+//==============================================================================
+/**
+    A fixed-size list of echo taps. It holds no heap memory, so the audio
+    thread can copy a new pattern in without allocating.
+
+    build() turns it into a DelayRouting. The stereo input is kept in three
+    history lanes (left, right and mid); each tap reads the one closest to its
+    side, and is placed with the VectorPanner's gains, so the kernel's tap by
+    lane gain matrix is the whole spatial render.
+*/
+struct TapPattern
+{
+    static constexpr int maxTaps = DelayRouting::maxTaps;
+
+    int         numTaps = 0;
+    EchoTap     taps[maxTaps];
+
+    bool addTap(const EchoTap& tap) noexcept
+    {
+        if (numTaps >= maxTaps)
+            return false;
+
+        taps[numTaps++] = tap;
+        return true;
+    }
+
+    /** Eight echoes spiralling once round the room and up, each a little quieter than the last. */
+    static TapPattern createDefault() noexcept
+    {
+        TapPattern pattern;
+
+        for (int i = 0; i < 8; ++i)
+        {
+            EchoTap tap;
+            tap.time        = (float)(i + 1) / 8.0f;
+            tap.gain        = std::pow(0.8f, (float)i);
+            tap.feedback    = i == 7 ? 1.0f : 0.0f;
+            tap.azimuth     = 30.0f - 45.0f * (float)i;
+            tap.elevation   = 60.0f * (float)i / 7.0f;
+            pattern.addTap(tap);
+        }
+
+        return pattern;
+    }
+
+    /** Longest echo, as a fraction of the Delay Time. */
+    float getLongestTime() const noexcept
+    {
+        float longest = 0.0f;
+
+        for (int i = 0; i < numTaps; ++i)
+            longest = jmax(longest, taps[i].time);
+
+        return longest;
+    }
+
+    /** Share of the line the echoes feed back between them on each pass, before the Feedback parameter. */
+    float getTotalFeedback() const noexcept
+    {
+        float total = 0.0f;
+
+        for (int i = 0; i < numTaps; ++i)
+            total += taps[i].feedback;
+
+        return total;
+    }
+
+    //==============================================================================
+    void build(DelayRouting& routing, const SpeakerLayout& layout, const VectorPanner& panner,
+               float delayInSamples, float mix, float feedback) const noexcept
+    {
+        enum { leftLane, rightLane, midLane };
+
+        routing.reset(layout);
+
+        // Layouts have at least the L/R pair; with only two lanes, centred taps read the left
+        const int lanes[] = { leftLane, rightLane, layout.numLanes > midLane ? (int)midLane : (int)leftLane };
+
+        routing.setHistoryInput(leftLane, 1.0f, 0.0f);
+        routing.setHistoryInput(rightLane, 0.0f, 1.0f);
+
+        if (layout.numLanes > midLane)
+            routing.setHistoryInput(midLane, 0.5f, 0.5f);
+
+        for (int channel = 0; channel < layout.numChannels; ++channel)
+        {
+            const auto& speaker = layout.speakers[channel];
+
+            if (speaker.group == SpeakerLayout::passthrough)
+                continue;
+
+            const float dry = speaker.group == SpeakerLayout::front ? 1.0f - mix : 0.0f;
+            routing.setOutput(channel, dry * speaker.leftWeight(), dry * speaker.rightWeight(), mix);
+        }
+
+        jassert(panner.getNumLanes() == layout.numLanes);
+
+        for (int i = 0; i < numTaps; ++i)
+        {
+            const auto& echo = taps[i];
+
+            // Sideways component of the direction, positive to the left
+            const float side = std::sin(degreesToRadians(echo.azimuth)) * std::cos(degreesToRadians(echo.elevation));
+            const int sourceLane = lanes[side > 0.25f ? leftLane : (side < -0.25f ? rightLane : midLane)];
+            const int tap = routing.addTap(echo.time * delayInSamples, sourceLane);
+
+            if (tap < 0)
+                break;
+
+            panner.getGains(echo.azimuth, echo.elevation, echo.gain, routing.tapOutput[tap]);
+            routing.tapFeedback[tap][sourceLane] = echo.feedback * feedback;
+        }
+    }
+
+    //==============================================================================
+    ValueTree toValueTree() const
+    {
+        ValueTree tree(type);
+
+        for (int i = 0; i < numTaps; ++i)
+        {
+            ValueTree child(tapType);
+            child.setProperty("time", taps[i].time, nullptr);
+            child.setProperty("gain", taps[i].gain, nullptr);
+            child.setProperty("feedback", taps[i].feedback, nullptr);
+            child.setProperty("azimuth", taps[i].azimuth, nullptr);
+            child.setProperty("elevation", taps[i].elevation, nullptr);
+            tree.appendChild(child, nullptr);
+        }
+
+        return tree;
+    }
+
+    static TapPattern fromValueTree(const ValueTree& tree)
+    {
+        TapPattern pattern;
+
+        for (int i = 0; i < tree.getNumChildren(); ++i)
+        {
+            const auto child = tree.getChild(i);
+
+            if (! child.hasType(tapType))
+                continue;
+
+            EchoTap tap;
+            tap.time        = jlimit(0.0f, 1.0f, (float)child.getProperty("time", tap.time));
+            tap.gain        = jlimit(0.0f, 2.0f, (float)child.getProperty("gain", tap.gain));
+            tap.feedback    = jlimit(0.0f, 1.0f, (float)child.getProperty("feedback", tap.feedback));
+            tap.azimuth     = (float)child.getProperty("azimuth", tap.azimuth);
+            tap.elevation   = jlimit(-90.0f, 90.0f, (float)child.getProperty("elevation", tap.elevation));
+
+            if (! pattern.addTap(tap))
+                break;
+        }
+
+        return pattern;
+    }
+
+    static inline const Identifier type { "TapPattern" };
+    static inline const Identifier tapType { "Tap" };
+};
@@ -0,0 +1,284 @@
+/*
+  ==============================================================================
+
+    VectorPanner.h
+    Vector-base amplitude panning over the current speaker layout.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "SpeakerLayout.h"
+
+//==============================================================================
+/**
+    Pans a direction over the delayed speakers with VBAP (Pulkki, 1997): the
+    layout is split into speaker triangles, and a direction is played by the
+    three speakers of the triangle it falls in, with gains solved from their
+    direction vectors and normalised to constant power.
+
+    The triangles are the faces of the convex hull of the speaker directions.
+    A virtual speaker below the listener closes the hull, and layouts with no
+    height speakers get one overhead as well; their gains are dropped and the
+    rest renormalised, so a raised echo on a 5.1 layout pans between the two
+    nearest horizontal speakers.
+
+    prepare() solves every direction on a grid of gridStep degrees into a gain
+    table, indexed by history lane like a DelayLine frame. getGains() only
+    blends the four surrounding grid points, so moving an echo costs a table
+    read and no trigonometry.
+*/
+class VectorPanner
+{
+public:
+    static constexpr int gridStep = 5;
+    static constexpr int numAzimuths = 360 / gridStep;
+    static constexpr int numElevations = 180 / gridStep + 1;
+
+    /** Rebuilds the triangles and gain table. Allocates, so call it from prepareToPlay. */
+    void prepare(const SpeakerLayout& layout)
+    {
+        numLanes = layout.numLanes;
+        findTriangles(layout);
+
+        table.calloc((size_t)(numAzimuths * numElevations * numLanes));
+
+        for (int row = 0; row < numElevations; ++row)
+            for (int column = 0; column < numAzimuths; ++column)
+                solve((float)(column * gridStep - 180), (float)(row * gridStep - 90), table + (row * numAzimuths + column) * numLanes);
+    }
+
+    int getNumLanes() const noexcept    { return numLanes; }
+
+    /** Writes getNumLanes() gains for a direction in degrees, scaled so their power sums to gain squared. */
+    void getGains(float azimuth, float elevation, float gain, float* gains) const noexcept
+    {
+        jassert(table != nullptr);
+
+        const float wrapped = azimuth + 180.0f - 360.0f * std::floor((azimuth + 180.0f) / 360.0f);
+        const float column = wrapped / (float)gridStep;
+        const float row = (jlimit(-90.0f, 90.0f, elevation) + 90.0f) / (float)gridStep;
+
+        const int column0 = jlimit(0, numAzimuths - 1, (int)column);
+        const int column1 = (column0 + 1) % numAzimuths;
+        const int row0 = jmin((int)row, numElevations - 2);
+        const float across = column - (float)column0;
+        const float up = row - (float)row0;
+
+        const float* corners[] = { getRow(row0, column0), getRow(row0, column1), getRow(row0 + 1, column0), getRow(row0 + 1, column1) };
+        const float weights[] = { (1.0f - across) * (1.0f - up), across * (1.0f - up), (1.0f - across) * up, across * up };
+
+        float power = 0.0f;
+
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            gains[lane] = weights[0] * corners[0][lane] + weights[1] * corners[1][lane]
+                        + weights[2] * corners[2][lane] + weights[3] * corners[3][lane];
+            power += gains[lane] * gains[lane];
+        }
+
+        if (power > 0.0f)
+            FloatVectorOperations::multiply(gains, gain / std::sqrt(power), numLanes);
+    }
+
+private:
+    struct Triangle
+    {
+        int     speakers[3];                // Indices into directions
+        float   inverse[3][3];              // Inverse of the matrix whose rows are the speaker directions
+    };
+
+    static constexpr int maxDirections = SpeakerLayout::maxChannels + 2;
+    static constexpr int maxTriangles = 2 * maxDirections;  // A convex hull of n points has 2n - 4 faces
+
+    float           directions[maxDirections][3] {};
+    int             directionLanes[maxDirections] {};       // History lane of each direction, or -1 for virtual speakers
+    int             numDirections = 0;
+
+    Triangle        triangles[maxTriangles * 4];            // Coplanar speakers give overlapping faces, any of which will do
+    int             numTriangles = 0;
+
+    HeapBlock<float> table;
+    int             numLanes = 0;
+
+    const float* getRow(int row, int column) const noexcept
+    {
+        return table + (row * numAzimuths + column) * numLanes;
+    }
+
+    void addDirection(float x, float y, float z, int lane)
+    {
+        directions[numDirections][0] = x;
+        directions[numDirections][1] = y;
+        directions[numDirections][2] = z;
+        directionLanes[numDirections++] = lane;
+    }
+
+    void findTriangles(const SpeakerLayout& layout)
+    {
+        numDirections = numTriangles = 0;
+        bool hasHeight = false;
+
+        for (int channel = 0; channel < layout.numChannels; ++channel)
+        {
+            const auto& speaker = layout.speakers[channel];
+
+            if (speaker.lane >= 0)
+            {
+                addDirection(speaker.x, speaker.y, speaker.z, speaker.lane);
+                hasHeight = hasHeight || speaker.elevation > 0.0f;
+            }
+        }
+
+        addDirection(0.0f, 0.0f, -1.0f, -1);
+
+        if (! hasHeight)
+            addDirection(0.0f, 0.0f, 1.0f, -1);
+
+        constexpr float tolerance = 1.0e-4f;
+
+        for (int a = 0; a < numDirections; ++a)
+        {
+            for (int b = a + 1; b < numDirections; ++b)
+            {
+                for (int c = b + 1; c < numDirections && numTriangles < (int)std::size(triangles); ++c)
+                {
+                    const float* p[] = { directions[a], directions[b], directions[c] };
+
+                    // Triangles through the listener cannot be inverted
+                    const float cross[] = { p[1][1] * p[2][2] - p[1][2] * p[2][1],
+                                            p[1][2] * p[2][0] - p[1][0] * p[2][2],
+                                            p[1][0] * p[2][1] - p[1][1] * p[2][0] };
+                    const float determinant = p[0][0] * cross[0] + p[0][1] * cross[1] + p[0][2] * cross[2];
+
+                    if (std::abs(determinant) < 1.0e-3f)
+                        continue;
+
+                    if (! isHullFace(a, b, c, tolerance))
+                        continue;
+
+                    auto& triangle = triangles[numTriangles++];
+                    triangle.speakers[0] = a;
+                    triangle.speakers[1] = b;
+                    triangle.speakers[2] = c;
+                    invert(p, determinant, triangle.inverse);
+                }
+            }
+        }
+
+        jassert(numTriangles > 0);
+    }
+
+    /** True when every other direction lies on the listener's side of the plane through a, b and c. */
+    bool isHullFace(int a, int b, int c, float tolerance) const noexcept
+    {
+        const float* pa = directions[a];
+        const float u[] = { directions[b][0] - pa[0], directions[b][1] - pa[1], directions[b][2] - pa[2] };
+        const float v[] = { directions[c][0] - pa[0], directions[c][1] - pa[1], directions[c][2] - pa[2] };
+        float normal[] = { u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0] };
+        const float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+        if (length < 1.0e-6f)
+            return false;
+
+        // Unit normal pointing away from the listener
+        const float offset = normal[0] * pa[0] + normal[1] * pa[1] + normal[2] * pa[2];
+
+        for (auto& n : normal)
+            n /= (offset < 0.0f ? -length : length);
+
+        const float distance = std::abs(offset) / length;
+
+        for (int other = 0; other < numDirections; ++other)
+        {
+            if (other == a || other == b || other == c)
+                continue;
+
+            const float* p = directions[other];
+
+            if (normal[0] * p[0] + normal[1] * p[1] + normal[2] * p[2] > distance + tolerance)
+                return false;
+        }
+
+        return true;
+    }
+
+    static void invert(const float* const* rows, float determinant, float (&inverse)[3][3]) noexcept
+    {
+        // Columns of the inverse are the cross products of pairs of rows
+        const float* r0 = rows[0];
+        const float* r1 = rows[1];
+        const float* r2 = rows[2];
+
+        inverse[0][0] = (r1[1] * r2[2] - r1[2] * r2[1]) / determinant;
+        inverse[1][0] = (r1[2] * r2[0] - r1[0] * r2[2]) / determinant;
+        inverse[2][0] = (r1[0] * r2[1] - r1[1] * r2[0]) / determinant;
+        inverse[0][1] = (r2[1] * r0[2] - r2[2] * r0[1]) / determinant;
+        inverse[1][1] = (r2[2] * r0[0] - r2[0] * r0[2]) / determinant;
+        inverse[2][1] = (r2[0] * r0[1] - r2[1] * r0[0]) / determinant;
+        inverse[0][2] = (r0[1] * r1[2] - r0[2] * r1[1]) / determinant;
+        inverse[1][2] = (r0[2] * r1[0] - r0[0] * r1[2]) / determinant;
+        inverse[2][2] = (r0[0] * r1[1] - r0[1] * r1[0]) / determinant;
+    }
+
+    /** Full VBAP solve for one direction, used only to fill the table. */
+    void solve(float azimuth, float elevation, float* gains) const noexcept
+    {
+        float x, y, z;
+        SpeakerLayout::toUnitVector(azimuth, elevation, x, y, z);
+
+        // The triangle the direction is deepest inside has the largest smallest gain
+        int best = -1;
+        float bestGains[3] {}, bestMinimum = -1.0e9f;
+
+        for (int i = 0; i < numTriangles; ++i)
+        {
+            const auto& inverse = triangles[i].inverse;
+            float g[3];
+
+            for (int k = 0; k < 3; ++k)
+                g[k] = x * inverse[0][k] + y * inverse[1][k] + z * inverse[2][k];
+
+            const float minimum = jmin(g[0], g[1], g[2]);
+
+            if (minimum > bestMinimum)
+            {
+                best = i;
+                bestMinimum = minimum;
+                std::copy(g, g + 3, bestGains);
+            }
+        }
+
+        FloatVectorOperations::clear(gains, numLanes);
+
+        if (best < 0)
+            return;
+
+        float power = 0.0f;
+
+        for (int k = 0; k < 3; ++k)
+        {
+            const int lane = directionLanes[triangles[best].speakers[k]];
+
+            if (lane >= 0)
+            {
+                gains[lane] = jmax(0.0f, bestGains[k]);
+                power += gains[lane] * gains[lane];
+            }
+        }
+
+        // Straight at a virtual speaker: nothing real is near, so spread it evenly
+        if (power <= 1.0e-12f)
+        {
+            for (int lane = 0; lane < numLanes; ++lane)
+                gains[lane] = 1.0f / std::sqrt((float)numLanes);
+
+            return;
+        }
+
+        FloatVectorOperations::multiply(gains, 1.0f / std::sqrt(power), numLanes);
+    }
+
+    JUCE_LEAK_DETECTOR (VectorPanner)
+};
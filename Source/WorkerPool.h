@@ -0,0 +1,254 @@
+/*
+  ==============================================================================
+
+    WorkerPool.h
+    Pre-spawned helper threads that share out independent jobs within one block.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "RealtimeSafety.h"
+
+using namespace juce;
+
+//==============================================================================
+/**
+    A fixed set of real-time threads, started from prepareToPlay, that the
+    audio thread hands numbered jobs to.
+
+    run() publishes a batch through a single atomic word holding the batch
+    number, its job count and the next unclaimed job, so a worker can never
+    claim a job from a batch it did not see published. The calling thread
+    claims jobs along with the workers, so a worker that is asleep or
+    descheduled only costs parallelism and never stalls the block.
+
+    Claiming a job only reserves it: a worker must still move the job's state
+    from pending to running before it starts. Once no jobs are left to claim,
+    the caller takes back every job that is still pending and runs it itself,
+    so a worker preempted between the two steps loses its job instead of
+    holding up the block. Only jobs already running are waited for, with a
+    spin bounded by maxWaitMicroseconds. A worker that runs past that has
+    been starved by the scheduler, so the pool marks itself unusable and
+    every later run() does its jobs on the calling thread until the next
+    start(). The late job writes into the caller's data, so it still has to
+    be waited for, by yielding; that is reported to RealtimeSafety as the
+    system call it is.
+
+    run() never signals, locks or allocates. Workers time their own wake-ups:
+    run() stamps each batch, and between batches a worker naps until
+    wakeAheadMilliseconds before the next one is due, then polls with
+    Thread::yield() for up to pollWindowMilliseconds. When no batch arrives,
+    as when the transport stops, they fall back to naps of maxNapMilliseconds.
+*/
+class WorkerPool
+{
+public:
+    using Job = void (*)(void* context, int jobIndex);
+
+    static constexpr int maxWorkers = 7;
+    static constexpr int maxJobs = 64;
+    static constexpr double maxWaitMicroseconds = 1000.0;
+    static constexpr double wakeAheadMilliseconds = 0.2;
+    static constexpr double pollWindowMilliseconds = 0.5;
+    static constexpr double maxNapMilliseconds = 1.0;
+
+    ~WorkerPool()
+    {
+        stop();
+    }
+
+    /** Starts numWorkers threads, stopping any running ones first. Call from the message thread or prepareToPlay. */
+    void start(int numWorkers)
+    {
+        stop();
+        usable.store(true, std::memory_order_relaxed);
+        batchStart.store(0.0, std::memory_order_relaxed);
+        batchInterval.store(0.0, std::memory_order_relaxed);
+
+        for (int i = 0; i < jlimit(0, maxWorkers, numWorkers); ++i)
+        {
+            auto* worker = workers.add(new Worker(*this, i));
+
+            if (! worker->startRealtimeThread(Thread::RealtimeOptions{}))
+                worker->startThread(Thread::Priority::highest);
+        }
+    }
+
+    void stop()
+    {
+        for (auto* worker : workers)
+        {
+            worker->signalThreadShouldExit();
+            worker->nap.signal();
+        }
+
+        for (auto* worker : workers)
+            worker->stopThread(1000);
+
+        workers.clear();
+    }
+
+    int getNumWorkers() const noexcept      { return workers.size(); }
+
+    /** False once a worker has held up run() for longer than maxWaitMicroseconds; jobs then all run on the caller. */
+    bool isUsable() const noexcept          { return usable.load(std::memory_order_relaxed); }
+
+    /** Runs job(context, i) for every i below numJobs, on the calling thread and the workers, and returns when all are done. */
+    void run(int numJobs, Job job, void* context) noexcept
+    {
+        jassert(numJobs <= maxJobs);
+
+        if (workers.isEmpty() || numJobs <= 1 || numJobs > maxJobs || ! isUsable())
+        {
+            for (int i = 0; i < numJobs; ++i)
+                job(context, i);
+
+            return;
+        }
+
+        // Workers plan their naps around when the next batch is due
+        const double now = Time::getMillisecondCounterHiRes();
+        const double sinceLast = now - batchStart.load(std::memory_order_relaxed);
+        batchInterval.store(sinceLast < 100.0 ? sinceLast : 0.0, std::memory_order_relaxed);
+        batchStart.store(now, std::memory_order_relaxed);
+
+        currentJob = job;
+        currentContext = context;
+        jobsDone.store(0, std::memory_order_relaxed);
+
+        const uint32 batch = ++batchNumber;
+
+        for (int i = 0; i < numJobs; ++i)
+            jobStates[i].store(makeState(batch, pending), std::memory_order_relaxed);
+
+        claims.store(((uint64)batch << 32) | ((uint64)numJobs << 16), std::memory_order_release);
+
+        runJobs(batch);
+
+        // Everything is claimed now; take back the jobs whose workers have not started them
+        for (int i = 0; i < numJobs; ++i)
+            if (startJob(batch, i, taken))
+                finishJob(i);
+
+        // The rest are running on awake workers and about to finish; the clock is read every 64 spins,
+        // which is cheap next to the jobs themselves
+        const double deadline = now + maxWaitMicroseconds * 0.001;
+
+        for (int spins = 1; jobsDone.load(std::memory_order_acquire) < numJobs; ++spins)
+        {
+            if ((spins & 63) == 0 && Time::getMillisecondCounterHiRes() > deadline)
+            {
+                usable.store(false, std::memory_order_relaxed);
+                RealtimeSafety::record(RealtimeSafety::systemCall, "Thread::yield, waiting for a late worker", nullptr);
+
+                while (jobsDone.load(std::memory_order_acquire) < numJobs)
+                    Thread::yield();
+
+                return;
+            }
+        }
+    }
+
+private:
+    //==============================================================================
+    enum JobPhase : uint64 { pending, running, taken };
+
+    struct Worker : public Thread
+    {
+        Worker(WorkerPool& p, int index) : Thread("Atmos worker " + String(index)), pool(p) {}
+
+        void run() override
+        {
+            uint32 lastBatch = 0;
+
+            while (! threadShouldExit())
+            {
+                const uint32 batch = (uint32)(pool.claims.load(std::memory_order_acquire) >> 32);
+
+                if (batch != lastBatch)
+                {
+                    lastBatch = batch;
+                    pool.runJobs(batch);
+                    continue;
+                }
+
+                const double interval = pool.batchInterval.load(std::memory_order_relaxed);
+                const double untilDue = pool.batchStart.load(std::memory_order_relaxed) + interval - Time::getMillisecondCounterHiRes();
+
+                if (interval <= 0.0 || untilDue < -pollWindowMilliseconds)
+                    nap.wait(maxNapMilliseconds);
+                else if (untilDue > wakeAheadMilliseconds)
+                    nap.wait(jmin(untilDue - wakeAheadMilliseconds, maxNapMilliseconds));
+                else
+                    Thread::yield();
+            }
+        }
+
+        WorkerPool&     pool;
+        WaitableEvent   nap;            // Only signalled by stop(); waiting on it is a sleep that exit can cut short
+    };
+
+    static uint64 makeState(uint32 batch, JobPhase phase) noexcept     { return ((uint64)batch << 2) | phase; }
+
+    /** Moves a job of the batch from pending to phase; false if someone else already has it, or the batch is over. */
+    bool startJob(uint32 batch, int index, JobPhase phase) noexcept
+    {
+        auto expected = makeState(batch, pending);
+        return jobStates[index].compare_exchange_strong(expected, makeState(batch, phase), std::memory_order_acq_rel);
+    }
+
+    void finishJob(int index) noexcept
+    {
+        currentJob(currentContext, index);
+        jobsDone.fetch_add(1, std::memory_order_release);
+    }
+
+    /** Claims and runs jobs of the given batch until there are none left. */
+    void runJobs(uint32 batch) noexcept
+    {
+        ATMOS_REALTIME_SCOPE("WorkerPool::runJobs");
+
+        auto claim = claims.load(std::memory_order_acquire);
+
+        for (;;)
+        {
+            // A stale batch number means the caller has already moved on
+            if ((uint32)(claim >> 32) != batch)
+                return;
+
+            const int numJobs = (int)((claim >> 16) & 0xffff);
+            const int index = (int)(claim & 0xffff);
+
+            if (index >= numJobs)
+                return;
+
+            if (! claims.compare_exchange_weak(claim, claim + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+                continue;
+
+            if (startJob(batch, index, running))
+                finishJob(index);
+
+            claim = claims.load(std::memory_order_acquire);
+        }
+    }
+
+    OwnedArray<Worker>      workers;
+
+    // Written by run() before the batch is published, read by workers once they have claimed a job from it
+    Job                     currentJob = nullptr;
+    void*                   currentContext = nullptr;
+    uint32                  batchNumber = 0;
+    std::atomic<bool>       usable { true };
+
+    // When the last batch was published and how long after the one before, in milliseconds; only a hint for naps
+    std::atomic<double>     batchStart { 0.0 }, batchInterval { 0.0 };
+
+    alignas(64) std::atomic<uint64> claims { 0 };          // Batch number : 32, job count : 16, next job : 16
+    alignas(64) std::atomic<int>    jobsDone { 0 };
+    std::atomic<uint64>             jobStates[maxJobs] {}; // Batch number : 62, phase : 2
+
+    JUCE_LEAK_DETECTOR (WorkerPool)
+};
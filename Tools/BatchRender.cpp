@@ -0,0 +1,443 @@
+/*
+  ==============================================================================
+
+    BatchRender.cpp
+    Offline rendering of audio files through Atmos3DDelayAudioProcessor.
+
+    Reads each input through a memory-mapped reader, runs it through
+    processBlock with a saved plugin state, keeps going until the echoes have
+    died away and writes a multichannel WAV, e.g.
+
+        Atmos3DDelayRender --state=hall.state --output-dir=renders --layout=7.1.2 dialogue.wav music.wav
+
+    Files are shared out over --jobs threads, each with its own processor.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+#include <iostream>
+
+using namespace juce;
+using namespace std;
+
+namespace
+{
+    struct RenderOptions
+    {
+        MemoryBlock     state;                  // Plugin state to load, empty for the defaults
+        AudioChannelSet layout;                 // Output layout, or disabled() to follow the input
+        File            outputDirectory;        // Empty to write next to each input
+        int             blockSize = 1024;
+        int             bitDepth = 32;
+        double          maxTailSeconds = 60.0;
+        float           silenceThreshold = Decibels::decibelsToGain(-100.0f);
+    };
+
+    struct RenderResult
+    {
+        File    input, output;
+        String  error;
+        double  inputSeconds = 0.0, tailSeconds = 0.0, renderSeconds = 0.0;
+        int     channels = 0;
+    };
+
+    /** The file a saved state came from: either the binary blob of getStateInformation, or the same state as XML. */
+    bool loadState(const File& file, MemoryBlock& state)
+    {
+        if (! file.loadFileAsData(state))
+            return false;
+
+        if (auto xml = parseXML(file))
+        {
+            state.reset();
+            AudioProcessor::copyXmlToBinary(*xml, state);
+        }
+
+        return state.getSize() > 0;
+    }
+
+    AudioChannelSet getLayoutForChannels(int numChannels)
+    {
+        switch (numChannels)
+        {
+            case 6:     return AudioChannelSet::create5point1();
+            case 8:     return AudioChannelSet::create7point1();
+            case 10:    return AudioChannelSet::create7point1point2();
+            case 12:    return AudioChannelSet::create7point1point4();
+            case 16:    return AudioChannelSet::create9point1point6();
+            default:    return AudioChannelSet::disabled();
+        }
+    }
+
+    /** Maps the whole file when its format supports it, and falls back to a streaming reader otherwise. */
+    unique_ptr<AudioFormatReader> createReader(AudioFormatManager& formats, const File& file)
+    {
+        if (auto* format = formats.findFormatForFileExtension(file.getFileExtension()))
+        {
+            unique_ptr<MemoryMappedAudioFormatReader> mapped(format->createMemoryMappedReader(file));
+
+            if (mapped != nullptr && mapped->mapEntireFile())
+                return unique_ptr<AudioFormatReader>(std::move(mapped));
+        }
+
+        return unique_ptr<AudioFormatReader>(formats.createReaderFor(file));
+    }
+
+    void render(Atmos3DDelayAudioProcessor& processor, const RenderOptions& options, RenderResult& result)
+    {
+        AudioFormatManager formats;
+        formats.registerBasicFormats();
+
+        auto reader = createReader(formats, result.input);
+
+        if (reader == nullptr)
+        {
+            result.error = "unsupported or unreadable file";
+            return;
+        }
+
+        const int numInputChannels = (int)reader->numChannels;
+        const auto outputLayout = options.layout.isDisabled() ? getLayoutForChannels(numInputChannels) : options.layout;
+
+        if (outputLayout.isDisabled())
+        {
+            result.error = String(numInputChannels) + " channels has no default layout, pass --layout";
+            return;
+        }
+
+        // A stereo or mono source feeds the front pair of the output layout
+        AudioProcessor::BusesLayout layout;
+        layout.inputBuses.add(numInputChannels == outputLayout.size() ? outputLayout
+                                                                      : AudioChannelSet::canonicalChannelSet(numInputChannels));
+        layout.outputBuses.add(outputLayout);
+
+        if (! processor.setBusesLayout(layout))
+        {
+            result.error = "cannot map " + String(numInputChannels) + " input channels to " + outputLayout.getDescription();
+            return;
+        }
+
+        const double sampleRate = reader->sampleRate;
+        const int blockSize = options.blockSize;
+
+        processor.setNonRealtime(true);
+        processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+        processor.prepareToPlay(sampleRate, blockSize);
+
+        result.output.deleteFile();
+        unique_ptr<OutputStream> stream(result.output.createOutputStream());
+        unique_ptr<AudioFormatWriter> writer;
+
+        if (stream != nullptr)
+            writer.reset(WavAudioFormat().createWriterFor(stream.get(), sampleRate, outputLayout, options.bitDepth, {}, 0));
+
+        if (writer == nullptr)
+        {
+            result.error = "cannot write " + result.output.getFullPathName();
+            processor.releaseResources();
+            return;
+        }
+
+        stream.release();   // Owned by the writer now
+
+        const int numChannels = jmax(numInputChannels, outputLayout.size());
+        const int latency = processor.getLatencySamples();
+        const int64 inputLength = reader->lengthInSamples;
+
+        const auto maxTail = (int64)(options.maxTailSeconds * sampleRate);
+
+        // The output must stay quiet for as long as the processor's routing reads back before nothing is left in the
+        // line. The routing is only built by processBlock, so the window is taken from it after every block; it covers
+        // every mode, Multi-Tap patterns and FDN lines included
+        int64 quietWindow = blockSize;
+
+        // Quiet blocks are held back until either something loud follows them or the window runs out, so the file
+        // ends at the last audible sample; the buffer grows to the window the first time it fills
+        AudioBuffer<float> buffer(numChannels, blockSize);
+        AudioBuffer<float> held(outputLayout.size(), blockSize);
+        int numHeld = 0;
+        MidiBuffer midi;
+
+        int64 position = 0, written = 0, quietSince = 0;
+        const auto start = Time::getMillisecondCounterHiRes();
+
+        for (;;)
+        {
+            const int64 tailPosition = position - inputLength;
+
+            if (tailPosition >= maxTail || (tailPosition >= latency && position - quietSince >= quietWindow))
+                break;
+
+            buffer.clear();
+
+            if (position < inputLength)
+                reader->read(buffer.getArrayOfWritePointers(), numInputChannels, position, (int)jmin((int64)blockSize, inputLength - position));
+
+            processor.processBlock(buffer, midi);
+            quietWindow = (int64)processor.getLongestReadDistance() + blockSize;
+
+            // Skip any reported latency so the render lines up with the source
+            const int skip = (int)jlimit((int64)0, (int64)blockSize, latency - position);
+            const int count = blockSize - skip;
+            position += blockSize;
+
+            if (count == 0)
+                continue;
+
+            // Only the tail is trimmed: a quiet stretch of the input itself is always written
+            bool isQuiet = written + numHeld >= inputLength;
+
+            for (int channel = 0; channel < outputLayout.size() && isQuiet; ++channel)
+                isQuiet = buffer.getMagnitude(channel, skip, count) < options.silenceThreshold;
+
+            if (! isQuiet)
+            {
+                quietSince = position;
+
+                if (numHeld > 0)
+                {
+                    writer->writeFromAudioSampleBuffer(held, 0, numHeld);
+                    written += numHeld;
+                    numHeld = 0;
+                }
+
+                writer->writeFromAudioSampleBuffer(buffer, skip, count);
+                written += count;
+            }
+            else
+            {
+                if (numHeld + count > held.getNumSamples())
+                    held.setSize(held.getNumChannels(), numHeld + count + blockSize, true, false, true);
+
+                for (int channel = 0; channel < outputLayout.size(); ++channel)
+                    held.copyFrom(channel, numHeld, buffer, channel, skip, count);
+
+                numHeld += count;
+            }
+        }
+
+        writer.reset();
+        processor.releaseResources();
+
+        result.channels = outputLayout.size();
+        result.inputSeconds = (double)inputLength / sampleRate;
+        result.tailSeconds = (double)jmax((int64)0, written - inputLength) / sampleRate;
+        result.renderSeconds = (Time::getMillisecondCounterHiRes() - start) * 1.0e-3;
+    }
+
+    void printUsage()
+    {
+        cout << "Atmos3DDelayRender [options] input.wav [input2.wav ...]" << endl
+             << "  --state=file                 saved plugin state, as the binary blob or XML (default: plugin defaults)" << endl
+             << "  --layout=7.1.2               output layout: 5.1, 5.1.2, 5.1.4, 7.1, 7.1.2, 7.1.4, 9.1.6" << endl
+             << "                               (default: taken from the input's channel count, which must then be 6, 8, 10, 12 or 16)" << endl
+             << "  --output-dir=dir             where to write the renders (default: next to each input)" << endl
+             << "  --suffix=_delay              added to each input's name; may only be empty with --output-dir" << endl
+             << "  --block-size=1024            samples per processBlock call" << endl
+             << "  --bits=32                    output bit depth: 16, 24 or 32 (float)" << endl
+             << "  --max-tail=60                longest tail in seconds rendered after the input ends" << endl
+             << "  --jobs=N                     files rendered at once (default: one per CPU core)" << endl
+             << "  --output=file.json           write a JSON summary of the renders" << endl
+             << endl
+             << "Inputs are read through memory-mapped readers where the format allows it (WAV, AIFF, and CAF on macOS)." << endl
+             << "Each render runs until the output has been below -100 dBFS for the longest delay, then ends at the last" << endl
+             << "audible sample." << endl;
+    }
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    // The parameter tree runs a Timer, so a message manager has to exist even when headless
+    ScopedJuceInitialiser_GUI juceInitialiser;
+
+    ArgumentList args(argc, argv);
+
+    if (args.containsOption("--help|-h") || args.size() == 0)
+    {
+        printUsage();
+        return 0;
+    }
+
+    RenderOptions options;
+
+    if (args.containsOption("--state"))
+    {
+        const auto stateFile = File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--state"));
+
+        if (! loadState(stateFile, options.state))
+        {
+            cerr << "Could not read state from " << stateFile.getFullPathName() << endl;
+            return 1;
+        }
+    }
+
+    if (args.containsOption("--layout"))
+    {
+        options.layout = SpeakerLayout::getLayoutForName(args.getValueForOption("--layout").trim());
+
+        if (options.layout.isDisabled())
+        {
+            cerr << "Unknown layout " << args.getValueForOption("--layout") << endl;
+            return 1;
+        }
+    }
+
+    if (args.containsOption("--output-dir"))
+    {
+        options.outputDirectory = File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--output-dir"));
+
+        if (! options.outputDirectory.createDirectory())
+        {
+            cerr << "Could not create " << options.outputDirectory.getFullPathName() << endl;
+            return 1;
+        }
+    }
+
+    if (args.containsOption("--block-size"))
+        options.blockSize = jlimit(16, 8192, args.getValueForOption("--block-size").getIntValue());
+
+    if (args.containsOption("--bits"))
+        options.bitDepth = args.getValueForOption("--bits").getIntValue();
+
+    if (options.bitDepth != 16 && options.bitDepth != 24 && options.bitDepth != 32)
+    {
+        cerr << "Unsupported bit depth " << options.bitDepth << endl;
+        return 1;
+    }
+
+    if (args.containsOption("--max-tail"))
+        options.maxTailSeconds = jmax(0.0, args.getValueForOption("--max-tail").getDoubleValue());
+
+    const String suffix = args.containsOption("--suffix") ? args.getValueForOption("--suffix") : String("_delay");
+
+    // Next to the input with no suffix, a .wav input would be rendered over itself, and deleted while it is still mapped
+    if (suffix.isEmpty() && ! args.containsOption("--output-dir"))
+    {
+        cerr << "An empty --suffix needs an --output-dir, or the renders would replace their inputs" << endl;
+        return 1;
+    }
+
+    vector<RenderResult> results;
+
+    for (auto& arg : args.arguments)
+    {
+        if (arg.isOption())
+            continue;
+
+        RenderResult result;
+        result.input = arg.resolveAsFile();
+        const auto directory = options.outputDirectory == File() ? result.input.getParentDirectory() : options.outputDirectory;
+        result.output = directory.getChildFile(result.input.getFileNameWithoutExtension() + suffix + ".wav");
+
+        if (result.output == result.input)
+        {
+            cerr << "Rendering " << result.input.getFullPathName() << " would replace it, pass another --suffix or --output-dir" << endl;
+            return 1;
+        }
+
+        results.push_back(result);
+    }
+
+    if (results.empty())
+    {
+        cerr << "No input files" << endl;
+        return 1;
+    }
+
+    const int numJobs = jlimit(1, (int)results.size(),
+                               args.containsOption("--jobs") ? args.getValueForOption("--jobs").getIntValue() : SystemStats::getNumCpus());
+
+    // Processors are built and given their state here, on the message thread; the jobs only prepare and run them
+    OwnedArray<Atmos3DDelayAudioProcessor> processors;
+
+    for (int job = 0; job < numJobs; ++job)
+    {
+        auto* processor = processors.add(new Atmos3DDelayAudioProcessor());
+
+        if (options.state.getSize() > 0)
+            processor->setStateInformation(options.state.getData(), (int)options.state.getSize());
+    }
+
+    // Each job works through the list with its own processor, taking the next file until none are left
+    std::atomic<int> nextFile { 0 };
+    std::atomic<int> jobsRunning { numJobs };
+    ThreadPool pool(numJobs);
+    const auto start = Time::getMillisecondCounterHiRes();
+
+    for (int job = 0; job < numJobs; ++job)
+    {
+        pool.addJob([&, job]
+        {
+            for (int index = nextFile++; index < (int)results.size(); index = nextFile++)
+                render(*processors[job], options, results[(size_t)index]);
+
+            --jobsRunning;
+        });
+    }
+
+    while (jobsRunning > 0)
+        Thread::sleep(10);
+
+    const double wallSeconds = (Time::getMillisecondCounterHiRes() - start) * 1.0e-3;
+
+    Array<var> summaries;
+    double totalAudioSeconds = 0.0;
+    int numFailed = 0;
+
+    for (auto& result : results)
+    {
+        DynamicObject::Ptr summary = new DynamicObject();
+        summary->setProperty("input", result.input.getFullPathName());
+
+        if (result.error.isNotEmpty())
+        {
+            cerr << result.input.getFileName() << ": " << result.error << endl;
+            summary->setProperty("error", result.error);
+            ++numFailed;
+        }
+        else
+        {
+            const double audioSeconds = result.inputSeconds + result.tailSeconds;
+            totalAudioSeconds += audioSeconds;
+
+            cerr << result.input.getFileName() << " -> " << result.output.getFileName() << ": " << String(audioSeconds, 2) << " s ("
+                 << String(result.tailSeconds, 2) << " s tail) in " << String(result.renderSeconds, 2) << " s" << endl;
+
+            summary->setProperty("output",          result.output.getFullPathName());
+            summary->setProperty("channels",        result.channels);
+            summary->setProperty("input_seconds",   result.inputSeconds);
+            summary->setProperty("tail_seconds",    result.tailSeconds);
+            summary->setProperty("render_seconds",  result.renderSeconds);
+            summary->setProperty("realtime_factor", result.renderSeconds > 0.0 ? audioSeconds / result.renderSeconds : 0.0);
+        }
+
+        summaries.add(summary.get());
+    }
+
+    cerr << results.size() - (size_t)numFailed << " of " << results.size() << " files rendered on " << numJobs << " threads, "
+         << String(totalAudioSeconds / jmax(wallSeconds, 1.0e-3), 1) << "x real time" << endl;
+
+    if (args.containsOption("--output"))
+    {
+        DynamicObject::Ptr report = new DynamicObject();
+        report->setProperty("plugin",           JucePlugin_Name);
+        report->setProperty("jobs",             numJobs);
+        report->setProperty("wall_seconds",     wallSeconds);
+        report->setProperty("audio_seconds",    totalAudioSeconds);
+        report->setProperty("files",            summaries);
+
+        const File outputFile = File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--output"));
+
+        if (! outputFile.replaceWithText(JSON::toString(report.get())))
+        {
+            cerr << "Could not write " << outputFile.getFullPathName() << endl;
+            return 1;
+        }
+    }
+
+    return numFailed > 0 ? 1 : 0;
+}